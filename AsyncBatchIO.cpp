@@ -0,0 +1,539 @@
+#include "AsyncBatchIO.h"
+#include "Decomposition.h"
+#include "Pipeline.h"
+#include<algorithm>
+#include<condition_variable>
+#include<cstdint>
+#include<cstring>
+#include<fstream>
+#include<limits>
+#include<mutex>
+#include<stdexcept>
+#include<thread>
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#define ASYNC_IO_URING
+#include<cerrno>
+#include<fcntl.h>
+#include<linux/io_uring.h>
+#include<sys/mman.h>
+#include<sys/stat.h>
+#include<sys/syscall.h>
+#include<sys/uio.h>
+#include<unistd.h>
+#endif
+
+namespace
+{
+	static_assert(sizeof(Mat2x2) == 4 * sizeof(double), "Mat2x2 must be four packed doubles");
+	static_assert(sizeof(Eigenvalues) == sizeof(Mat2x2), "Eigenvalues must fit in place of a Mat2x2");
+
+	/*
+	* to fill up to max matrices from the file
+
+	* @return the number of matrices read, 0 at the end of the file
+	*/
+	std::size_t readChunk(std::ifstream& in, Mat2x2* m, std::size_t max)
+	{
+		in.read(reinterpret_cast<char*>(m), max * sizeof(Mat2x2));
+		if (in.bad())
+			throw std::runtime_error("read failed");
+		const std::size_t bytes = static_cast<std::size_t>(in.gcount());
+		if (bytes % sizeof(Mat2x2) != 0)
+			throw std::runtime_error("truncated matrix file");
+		return bytes / sizeof(Mat2x2);
+	}
+
+	void writeChunk(std::ofstream& out, const Mat2x2* m, std::size_t n)
+	{
+		out.write(reinterpret_cast<const char*>(m), n * sizeof(Mat2x2));
+		if (!out)
+			throw std::runtime_error("write failed");
+	}
+
+	void compute(Mat2x2* m, std::size_t n, BatchOperation operation, Mat2x2 operand)
+	{
+		const double nan = std::numeric_limits<double>::quiet_NaN();
+		for (std::size_t i = 0; i < n; i++)
+		{
+			switch (operation)
+			{
+			case BatchOperation::Multiply:
+				m[i] *= operand;
+				break;
+			case BatchOperation::Inverse:
+				try
+				{
+					m[i] = m[i].inverse();
+				}
+				catch (const std::overflow_error&)
+				{
+					m[i] = Mat2x2(nan, nan, nan, nan);
+				}
+				break;
+			case BatchOperation::Eigenvalues:
+			{
+				Eigenvalues e = eigenvalues(m[i]);
+				m[i] = Mat2x2(e.re1, e.im1, e.re2, e.im2);
+				break;
+			}
+			}
+		}
+	}
+
+#ifdef ASYNC_IO_URING
+	/*
+	* the fixed compute threads of the io_uring path: run() splits a
+		chunk between workers - 1 of them and the calling thread, and
+		returns when every share is done
+	*/
+	class ComputePool
+	{
+	private:
+		BatchOperation operation;
+		Mat2x2 operand;
+		std::vector<std::thread> helpers;
+		std::mutex lock;
+		std::condition_variable wake, finished;
+		Mat2x2* chunk;
+		std::size_t n;
+		std::size_t generation;
+		std::size_t remaining;
+		bool stopping;
+
+		void share(std::size_t k)
+		{
+			const std::size_t shares = this->helpers.size() + 1;
+			const std::size_t begin = this->n * k / shares, end = this->n * (k + 1) / shares;
+			compute(this->chunk + begin, end - begin, this->operation, this->operand);
+		}
+
+		void help(std::size_t k)
+		{
+			std::size_t seen = 0;
+			for (;;)
+			{
+				{
+					std::unique_lock<std::mutex> guard(this->lock);
+					this->wake.wait(guard, [&]() { return this->stopping || this->generation != seen; });
+					if (this->stopping)
+						return;
+					seen = this->generation;
+				}
+				this->share(k);
+				std::lock_guard<std::mutex> guard(this->lock);
+				if (--this->remaining == 0)
+					this->finished.notify_one();
+			}
+		}
+	public:
+		ComputePool(std::size_t workers, BatchOperation operation, const Mat2x2& operand)
+			: operation{ operation }, operand(operand), chunk{ nullptr }, n{ 0 }, generation{ 0 }, remaining{ 0 }, stopping{ false }
+		{
+			for (std::size_t k = 1; k < workers; k++)
+				this->helpers.emplace_back(&ComputePool::help, this, k);
+		}
+
+		~ComputePool()
+		{
+			{
+				std::lock_guard<std::mutex> guard(this->lock);
+				this->stopping = true;
+			}
+			this->wake.notify_all();
+			for (std::thread& helper : this->helpers)
+				helper.join();
+		}
+
+		void run(Mat2x2* m, std::size_t count)
+		{
+			{
+				std::lock_guard<std::mutex> guard(this->lock);
+				this->chunk = m;
+				this->n = count;
+				this->remaining = this->helpers.size();
+				this->generation++;
+			}
+			this->wake.notify_all();
+			this->share(0);
+			std::unique_lock<std::mutex> guard(this->lock);
+			this->finished.wait(guard, [&]() { return this->remaining == 0; });
+		}
+	};
+
+	/*
+	* a minimal io_uring through the raw system calls, so no liburing is
+		needed: one thread prepares vectored reads and writes and waits
+		for their completions. ready() is false when the kernel refuses
+		io_uring (too old, disabled or filtered), the caller falls back
+	*/
+	class Uring
+	{
+	private:
+		int fd;
+		void* sqRing;
+		std::size_t sqRingBytes;
+		void* cqRing;
+		std::size_t cqRingBytes;
+		io_uring_sqe* sqes;
+		std::size_t sqesBytes;
+		unsigned* sqTail;
+		unsigned* sqMask;
+		unsigned* sqArray;
+		unsigned* cqHead;
+		unsigned* cqTail;
+		unsigned* cqMask;
+		io_uring_cqe* cqes;
+		unsigned unsubmitted;
+	public:
+		explicit Uring(unsigned entries) : fd{ -1 }, sqRing{ MAP_FAILED }, sqRingBytes{ 0 }, cqRing{ MAP_FAILED }, cqRingBytes{ 0 },
+			sqes{ nullptr }, sqesBytes{ 0 }, unsubmitted{ 0 }
+		{
+			io_uring_params params;
+			std::memset(&params, 0, sizeof params);
+			this->fd = static_cast<int>(::syscall(__NR_io_uring_setup, entries, &params));
+			if (this->fd < 0)
+				return;
+			this->sqRingBytes = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+			this->cqRingBytes = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+			this->sqesBytes = params.sq_entries * sizeof(io_uring_sqe);
+			this->sqRing = ::mmap(nullptr, this->sqRingBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, this->fd, IORING_OFF_SQ_RING);
+			this->cqRing = ::mmap(nullptr, this->cqRingBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, this->fd, IORING_OFF_CQ_RING);
+			void* entriesMap = ::mmap(nullptr, this->sqesBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, this->fd, IORING_OFF_SQES);
+			if (this->sqRing == MAP_FAILED || this->cqRing == MAP_FAILED || entriesMap == MAP_FAILED)
+			{
+				if (entriesMap != MAP_FAILED)
+					::munmap(entriesMap, this->sqesBytes);
+				this->release();
+				return;
+			}
+			this->sqes = static_cast<io_uring_sqe*>(entriesMap);
+			char* sq = static_cast<char*>(this->sqRing);
+			char* cq = static_cast<char*>(this->cqRing);
+			this->sqTail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+			this->sqMask = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+			this->sqArray = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+			this->cqHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+			this->cqTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+			this->cqMask = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+			this->cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+		}
+
+		Uring(const Uring&) = delete;
+		Uring& operator=(const Uring&) = delete;
+
+		~Uring()
+		{
+			this->release();
+		}
+
+		void release()
+		{
+			if (this->sqes != nullptr)
+				::munmap(this->sqes, this->sqesBytes);
+			if (this->cqRing != MAP_FAILED)
+				::munmap(this->cqRing, this->cqRingBytes);
+			if (this->sqRing != MAP_FAILED)
+				::munmap(this->sqRing, this->sqRingBytes);
+			if (this->fd >= 0)
+				::close(this->fd);
+			this->sqes = nullptr;
+			this->cqRing = this->sqRing = MAP_FAILED;
+			this->fd = -1;
+		}
+
+		bool ready() const
+		{
+			return this->fd >= 0;
+		}
+
+		//the caller keeps fewer operations in flight than the ring has entries
+		void prepare(std::uint8_t opcode, int file, const iovec* vector, std::uint64_t offset, std::uint64_t tag)
+		{
+			const unsigned tail = *this->sqTail;
+			const unsigned index = tail & *this->sqMask;
+			io_uring_sqe& entry = this->sqes[index];
+			std::memset(&entry, 0, sizeof entry);
+			entry.opcode = opcode;
+			entry.fd = file;
+			entry.addr = reinterpret_cast<std::uint64_t>(vector);
+			entry.len = 1;
+			entry.off = offset;
+			entry.user_data = tag;
+			this->sqArray[index] = index;
+			__atomic_store_n(this->sqTail, tail + 1, __ATOMIC_RELEASE);
+			this->unsubmitted++;
+		}
+
+		//submits what was prepared and waits for the next completion
+		io_uring_cqe next()
+		{
+			for (;;)
+			{
+				const unsigned head = *this->cqHead;
+				if (head != __atomic_load_n(this->cqTail, __ATOMIC_ACQUIRE))
+				{
+					const io_uring_cqe completion = this->cqes[head & *this->cqMask];
+					__atomic_store_n(this->cqHead, head + 1, __ATOMIC_RELEASE);
+					return completion;
+				}
+				const long submitted = ::syscall(__NR_io_uring_enter, this->fd, this->unsubmitted, 1, IORING_ENTER_GETEVENTS, nullptr, 0);
+				if (submitted < 0)
+				{
+					if (errno == EINTR || errno == EAGAIN || errno == EBUSY)
+						continue;
+					throw std::runtime_error("io_uring_enter failed");
+				}
+				this->unsubmitted -= static_cast<unsigned>(submitted);
+			}
+		}
+	};
+
+	//closes on every path out of processWithUring()
+	struct Descriptor
+	{
+		int fd;
+		~Descriptor()
+		{
+			if (this->fd >= 0)
+				::close(this->fd);
+		}
+	};
+
+	//chunks in memory on the io_uring path: one computing, the others reading or writing
+	const std::size_t uringSlots = 4;
+
+	/*
+	* the io_uring path of processFile(). Every chunk is written at the
+		offset it was read from, so reads and writes may complete in any
+		order; a short read or write is resubmitted for the rest
+
+	* @param  processed - set to the number of matrices processed
+
+	* @return false if the kernel refuses io_uring, nothing has been touched then
+	*/
+	bool processWithUring(const std::string& inPath, const std::string& outPath, BatchOperation operation,
+		const Mat2x2& operand, const FileBatchOptions& options, std::size_t& processed)
+	{
+		Uring ring(2 * uringSlots);
+		if (!ring.ready())
+			return false;
+		Descriptor in{ ::open(inPath.c_str(), O_RDONLY | O_CLOEXEC) };
+		if (in.fd < 0)
+			throw std::runtime_error("cannot open " + inPath);
+		struct stat status;
+		if (::fstat(in.fd, &status) != 0)
+			throw std::runtime_error("read failed");
+		const std::uint64_t totalBytes = static_cast<std::uint64_t>(status.st_size);
+		if (totalBytes % sizeof(Mat2x2) != 0)
+			throw std::runtime_error("truncated matrix file");
+		Descriptor out{ ::open(outPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644) };
+		if (out.fd < 0)
+			throw std::runtime_error("cannot open " + outPath);
+
+		struct Slot
+		{
+			std::vector<Mat2x2> buffer;
+			iovec vector;
+			std::uint64_t offset;
+			std::size_t bytes;
+			std::size_t done;
+			bool writing;
+		};
+		const std::size_t chunkBytes = options.chunkSize * sizeof(Mat2x2);
+		std::vector<Slot> slots(uringSlots);
+		std::uint64_t nextOffset = 0;
+		std::size_t inFlight = 0;
+		auto submit = [&](std::size_t s)
+		{
+			Slot& slot = slots[s];
+			slot.vector.iov_base = reinterpret_cast<char*>(slot.buffer.data()) + slot.done;
+			slot.vector.iov_len = slot.bytes - slot.done;
+			ring.prepare(slot.writing ? IORING_OP_WRITEV : IORING_OP_READV, slot.writing ? out.fd : in.fd, &slot.vector, slot.offset + slot.done, s);
+			inFlight++;
+		};
+		auto read = [&](std::size_t s)
+		{
+			if (nextOffset == totalBytes)
+				return;
+			Slot& slot = slots[s];
+			slot.offset = nextOffset;
+			slot.bytes = static_cast<std::size_t>(std::min<std::uint64_t>(chunkBytes, totalBytes - nextOffset));
+			slot.done = 0;
+			slot.writing = false;
+			nextOffset += slot.bytes;
+			submit(s);
+		};
+
+		ComputePool pool(options.workers, operation, operand);
+		processed = 0;
+		for (std::size_t s = 0; s < slots.size(); s++)
+		{
+			slots[s].buffer.resize(options.chunkSize);
+			read(s);
+		}
+		try
+		{
+			while (inFlight > 0)
+			{
+				const io_uring_cqe completion = ring.next();
+				inFlight--;
+				const std::size_t s = static_cast<std::size_t>(completion.user_data);
+				Slot& slot = slots[s];
+				//a read that returns nothing means the file shrank under us
+				if (completion.res <= 0)
+					throw std::runtime_error(slot.writing ? "write failed" : "read failed");
+				slot.done += static_cast<std::size_t>(completion.res);
+				if (slot.done < slot.bytes)
+					submit(s);
+				else if (!slot.writing)
+				{
+					pool.run(slot.buffer.data(), slot.bytes / sizeof(Mat2x2));
+					slot.writing = true;
+					slot.done = 0;
+					submit(s);
+				}
+				else
+				{
+					processed += slot.bytes / sizeof(Mat2x2);
+					read(s);
+				}
+			}
+		}
+		catch (...)
+		{
+			//the kernel may still be filling the buffers, wait for it before they are freed
+			while (inFlight > 0)
+			{
+				ring.next();
+				inFlight--;
+			}
+			throw;
+		}
+		return true;
+	}
+#endif
+}
+
+/*
+* to write matrices to a file
+
+* @param  path - the file to create or overwrite
+* @param  m - pointer to the first matrix
+* @param  n - the number of matrices
+*/
+void writeMatrixFile(const std::string& path, const Mat2x2* m, std::size_t n)
+{
+	std::ofstream out(path, std::ios::binary | std::ios::trunc);
+	if (!out)
+		throw std::runtime_error("cannot open " + path);
+	out.write(reinterpret_cast<const char*>(m), n * sizeof(Mat2x2));
+	if (!out)
+		throw std::runtime_error("write failed");
+}
+
+/*
+* to read every matrix of a file, throws if it ends inside a matrix
+
+* @param  path - the file to read
+
+* @return a vector of the matrices
+*/
+std::vector<Mat2x2> readMatrixFile(const std::string& path)
+{
+	std::ifstream in(path, std::ios::binary | std::ios::ate);
+	if (!in)
+		throw std::runtime_error("cannot open " + path);
+	const std::size_t bytes = static_cast<std::size_t>(in.tellg());
+	if (bytes % sizeof(Mat2x2) != 0)
+		throw std::runtime_error("truncated matrix file");
+	std::vector<Mat2x2> result(bytes / sizeof(Mat2x2));
+	in.seekg(0);
+	in.read(reinterpret_cast<char*>(result.data()), result.size() * sizeof(Mat2x2));
+	return result;
+}
+
+/*
+* to apply an operation to every matrix of a file and write the results
+	to another, overlapping disk and CPU
+
+* on Linux it runs on io_uring (see FileBatchOptions), when the kernel
+	refuses io_uring or options.ioUring is false on a Pipeline (see
+	Pipeline.h): its source thread reads chunks, options.workers stages
+	each compute their share of every chunk, and the calling thread
+	writes them in input order. Either way the threads are fixed for the
+	whole file and the chunks in flight are bounded, whatever the size
+	of the file.
+
+* @param  inPath - the matrix file to read
+* @param  outPath - the file the results are written to
+* @param  operation - what to compute for every matrix
+* @param  operand - the right hand side of BatchOperation::Multiply
+* @param  options - chunk size and number of compute threads
+
+* @return the number of matrices processed, throws if the input ends
+	inside a matrix
+*/
+std::size_t processFile(const std::string& inPath, const std::string& outPath, BatchOperation operation,
+	const Mat2x2& operand, const FileBatchOptions& options)
+{
+	if (options.chunkSize == 0 || options.workers == 0)
+		throw std::invalid_argument("Invalid arguments");
+#ifdef ASYNC_IO_URING
+	std::size_t processed = 0;
+	if (options.ioUring && processWithUring(inPath, outPath, operation, operand, options, processed))
+		return processed;
+#endif
+	std::ifstream in(inPath, std::ios::binary);
+	if (!in)
+		throw std::runtime_error("cannot open " + inPath);
+	std::ofstream out(outPath, std::ios::binary | std::ios::trunc);
+	if (!out)
+		throw std::runtime_error("cannot open " + outPath);
+
+	//one chunk waiting between two threads is enough to keep every one of them busy
+	Pipeline pipeline(options.chunkSize, 1);
+	const std::size_t workers = options.workers;
+	const Mat2x2 right = operand;
+	for (std::size_t k = 0; k < workers; k++)
+	{
+		pipeline.then([k, workers, operation, right](Pipeline::Chunk& chunk)
+		{
+			const std::size_t begin = chunk.size() * k / workers, end = chunk.size() * (k + 1) / workers;
+			compute(chunk.data() + begin, end - begin, operation, right);
+		});
+	}
+
+	std::size_t written = 0;
+	pipeline.run([&in](Mat2x2* m, std::size_t max) { return readChunk(in, m, max); },
+		[&](const Mat2x2* m, std::size_t n)
+	{
+		writeChunk(out, m, n);
+		written += n;
+	});
+	return written;
+}
+
+/*
+* to start processFile() on a thread of its own, invalid options throw
+	here, everything else is rethrown by get()
+
+* @param  inPath - the matrix file to read
+* @param  outPath - the file the results are written to
+* @param  operation - what to compute for every matrix
+* @param  operand - the right hand side of BatchOperation::Multiply
+* @param  options - chunk size, number of compute threads and I/O path
+
+* @return a future of the number of matrices processed
+*/
+std::future<std::size_t> processFileAsync(const std::string& inPath, const std::string& outPath, BatchOperation operation,
+	const Mat2x2& operand, const FileBatchOptions& options)
+{
+	if (options.chunkSize == 0 || options.workers == 0)
+		throw std::invalid_argument("Invalid arguments");
+	const Mat2x2 right = operand;
+	return std::async(std::launch::async, [inPath, outPath, operation, right, options]()
+	{
+		return processFile(inPath, outPath, operation, right, options);
+	});
+}
@@ -0,0 +1,61 @@
+#ifndef ASYNCBATCHIO_H
+#define ASYNCBATCHIO_H
+#include<cstddef>
+#include<future>
+#include<string>
+#include<vector>
+#include"Mat2x2.h"
+
+/*
+* matrix files are raw arrays of Mat2x2 in native byte order,
+	four doubles a, b, c, d per matrix; a file that ends inside a
+	matrix is truncated and reading it throws std::runtime_error
+*/
+void writeMatrixFile(const std::string&, const Mat2x2*, std::size_t);
+std::vector<Mat2x2> readMatrixFile(const std::string&);
+
+enum class BatchOperation
+{
+	Multiply,		//m * operand
+	Inverse,		//m.inverse(), all NaN where inverse() throws
+	Eigenvalues		//the Eigenvalues struct, re1 im1 re2 im2, stored in place of the matrix
+};
+
+/*
+* processFile() overlaps reading, computing and writing in one of two ways
+
+	io_uring (Linux, when the kernel allows it) - the thread running the
+	file keeps reads of the next chunks and writes of finished ones in
+	flight in the kernel while the compute threads share the current
+	chunk. 4 chunks in memory.
+
+	threads (everywhere else, or ioUring = false) - a Pipeline whose
+	reader thread makes blocking fstream reads while workers stages
+	compute and the running thread writes. workers + 1 threads and at
+	most 2 * workers + 3 chunks in memory.
+
+	Either way the threads are fixed for the whole file.
+*/
+struct FileBatchOptions
+{
+	std::size_t chunkSize = 64 * 1024;	//matrices per chunk, 2 MB
+	std::size_t workers = 4;			//compute threads, each takes its share of every chunk
+	bool ioUring = true;				//false forces the threaded path
+};
+
+std::size_t processFile(const std::string&, const std::string&, BatchOperation,
+	const Mat2x2& = Mat2x2(1, 0, 0, 1), const FileBatchOptions& = FileBatchOptions());
+
+/*
+* processFile() on a thread of its own, it returns at once. get() on
+	the future gives the number of matrices processed or rethrows what
+	processFile() threw; like every std::async future, destroying it
+	waits for the file to be done
+
+	std::future<std::size_t> done = processFileAsync("in.bin", "out.bin", BatchOperation::Inverse);
+	...
+	std::size_t n = done.get();
+*/
+std::future<std::size_t> processFileAsync(const std::string&, const std::string&, BatchOperation,
+	const Mat2x2& = Mat2x2(1, 0, 0, 1), const FileBatchOptions& = FileBatchOptions());
+#endif
@@ -0,0 +1,1026 @@
+#include "Bench.h"
+#include "AsyncBatchIO.h"
+#include "Decomposition.h"
+#include "MatArena.h"
+#include "Conditioning.h"
+#include "CompressedMatrices.h"
+#include "CpuDispatch.h"
+#include "Interval.h"
+#include "MatrixGenerator.h"
+#include "MatQueue.h"
+#include "ShardedBatch.h"
+#include "SlidingWindow.h"
+#include "StructuredMat.h"
+#include<algorithm>
+#include<chrono>
+#include<cmath>
+#include<cstdint>
+#include<cstdio>
+#include<mutex>
+#include<stdexcept>
+#include<thread>
+#include<vector>
+
+namespace
+{
+	//results are folded into it so the compiler cannot drop the work being timed
+	volatile double sink;
+
+	/*
+	* to time f, which handles n items per call
+
+	* @return the nanoseconds per item of the fastest of runs calls
+	*/
+	template<typename F>
+	double nanosecondsPer(std::size_t n, F f, int runs = 5)
+	{
+		double best = 0;
+		for (int run = 0; run < runs; run++)
+		{
+			const auto start = std::chrono::steady_clock::now();
+			f();
+			const std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+			if (run == 0 || elapsed.count() < best)
+				best = elapsed.count();
+		}
+		return best / n;
+	}
+
+	/*
+	* one table of the report, the first row is the baseline of the speedups
+	*/
+	class Table
+	{
+	private:
+		std::ostream& out;
+		double baseline;
+	public:
+		Table(std::ostream& out, const char* title, const char* unit = "ns/matrix") : out(out), baseline{ 0 }
+		{
+			this->out << "\n" << title << " (" << unit << ")\n";
+		}
+
+		void row(const std::string& name, double time, const std::string& note = "")
+		{
+			if (this->baseline == 0)
+				this->baseline = time;
+			char line[160];
+			std::snprintf(line, sizeof line, "  %-36s %10.2f  x%-6.2f %s", name.c_str(), time, this->baseline / time, note.c_str());
+			this->out << line << "\n";
+		}
+	};
+
+	/*
+	* user-029: one request's scratch batch, eigenvalues and partition
+		from the default heap and from a MatArena, with allocations counted
+	*/
+	void benchArena(std::ostream& out)
+	{
+		const std::size_t requests = 2000, batchSize = 256;
+		const std::vector<Mat2x2> input = generate(Distribution::Uniform, batchSize, 29);
+		auto request = [&](std::pmr::memory_resource* resource)
+		{
+			std::pmr::vector<Mat2x2> scratch(input.begin(), input.end(), resource);
+			std::pmr::vector<Eigenvalues> roots = eigenvalues(scratch.data(), scratch.size(), resource);
+			ConditionPartition partition = partitionByConditioning(scratch.data(), scratch.size(), defaultMaxCondition, resource);
+			sink = sink + roots[0].re1 + partition.wellConditioned.size();
+		};
+
+		CountingResource heap(std::pmr::new_delete_resource());
+		Table table(out, "arena: one request of 256 matrices", "ns/request");
+		const double heapTime = nanosecondsPer(requests, [&]()
+		{
+			for (std::size_t r = 0; r < requests; r++)
+				request(&heap);
+		});
+		//counted on a request of its own, the timed runs are repeated
+		CountingResource counted(std::pmr::new_delete_resource());
+		request(&counted);
+		table.row("new/delete", heapTime, std::to_string(counted.allocations()) + " allocations/request");
+
+		CountingResource upstream(std::pmr::new_delete_resource());
+		MatArena arena(64 * 1024, &upstream);
+		const double arenaTime = nanosecondsPer(requests, [&]()
+		{
+			for (std::size_t r = 0; r < requests; r++)
+			{
+				request(arena.resource());
+				arena.release();
+			}
+		});
+		table.row("MatArena", arenaTime, std::to_string(upstream.allocations()) + " allocations in total");
+	}
+
+	/*
+	* the general-purpose path the user-027 closed forms replace: dense
+		routines written for any N, the way a linear algebra library does
+		it, instantiated on 2. Jacobi sweeps run until the off-diagonal
+		part is negligible, rather than one rotation that is known to be
+		enough for 2x2
+	*/
+	const double jacobiTolerance = 1.e-15;
+	const int maxSweeps = 50;
+
+	template<std::size_t N>
+	void jacobiEigen(double a[N][N], double v[N][N], double lambda[N])
+	{
+		for (std::size_t i = 0; i < N; i++)
+			for (std::size_t j = 0; j < N; j++)
+				v[i][j] = i == j ? 1 : 0;
+		for (int sweep = 0; sweep < maxSweeps; sweep++)
+		{
+			double off = 0, all = 0;
+			for (std::size_t i = 0; i < N; i++)
+				for (std::size_t j = 0; j < N; j++)
+				{
+					all += a[i][j] * a[i][j];
+					if (i != j)
+						off += a[i][j] * a[i][j];
+				}
+			if (off <= jacobiTolerance * jacobiTolerance * all)
+				break;
+			for (std::size_t p = 0; p < N; p++)
+				for (std::size_t q = p + 1; q < N; q++)
+				{
+					if (a[p][q] == 0)
+						continue;
+					const double theta = (a[q][q] - a[p][p]) / (2 * a[p][q]);
+					const double t = (theta >= 0 ? 1 : -1) / (std::abs(theta) + std::sqrt(theta * theta + 1));
+					const double c = 1 / std::sqrt(t * t + 1), s = t * c;
+					for (std::size_t k = 0; k < N; k++)
+					{
+						const double kp = a[k][p], kq = a[k][q];
+						a[k][p] = c * kp - s * kq;
+						a[k][q] = s * kp + c * kq;
+					}
+					for (std::size_t k = 0; k < N; k++)
+					{
+						const double pk = a[p][k], qk = a[q][k];
+						a[p][k] = c * pk - s * qk;
+						a[q][k] = s * pk + c * qk;
+						const double vp = v[k][p], vq = v[k][q];
+						v[k][p] = c * vp - s * vq;
+						v[k][q] = s * vp + c * vq;
+					}
+				}
+		}
+		for (std::size_t i = 0; i < N; i++)
+			lambda[i] = a[i][i];
+	}
+
+	//one-sided (Hestenes) Jacobi: rotates the columns of u = a until they are orthogonal
+	template<std::size_t N>
+	void jacobiSvd(double u[N][N], double v[N][N], double sigma[N])
+	{
+		for (std::size_t i = 0; i < N; i++)
+			for (std::size_t j = 0; j < N; j++)
+				v[i][j] = i == j ? 1 : 0;
+		for (int sweep = 0; sweep < maxSweeps; sweep++)
+		{
+			bool rotated = false;
+			for (std::size_t p = 0; p < N; p++)
+				for (std::size_t q = p + 1; q < N; q++)
+				{
+					double alpha = 0, beta = 0, gamma = 0;
+					for (std::size_t k = 0; k < N; k++)
+					{
+						alpha += u[k][p] * u[k][p];
+						beta += u[k][q] * u[k][q];
+						gamma += u[k][p] * u[k][q];
+					}
+					if (std::abs(gamma) <= jacobiTolerance * std::sqrt(alpha * beta))
+						continue;
+					rotated = true;
+					const double zeta = (beta - alpha) / (2 * gamma);
+					const double t = (zeta >= 0 ? 1 : -1) / (std::abs(zeta) + std::sqrt(zeta * zeta + 1));
+					const double c = 1 / std::sqrt(t * t + 1), s = t * c;
+					for (std::size_t k = 0; k < N; k++)
+					{
+						const double up = u[k][p], uq = u[k][q];
+						u[k][p] = c * up - s * uq;
+						u[k][q] = s * up + c * uq;
+						const double vp = v[k][p], vq = v[k][q];
+						v[k][p] = c * vp - s * vq;
+						v[k][q] = s * vp + c * vq;
+					}
+				}
+			if (!rotated)
+				break;
+		}
+		for (std::size_t j = 0; j < N; j++)
+		{
+			double norm = 0;
+			for (std::size_t k = 0; k < N; k++)
+				norm += u[k][j] * u[k][j];
+			sigma[j] = std::sqrt(norm);
+			for (std::size_t k = 0; k < N && sigma[j] != 0; k++)
+				u[k][j] /= sigma[j];
+		}
+	}
+
+	//Householder reflections, a becomes r and q accumulates the reflections
+	template<std::size_t N>
+	void householderQr(double a[N][N], double q[N][N])
+	{
+		for (std::size_t i = 0; i < N; i++)
+			for (std::size_t j = 0; j < N; j++)
+				q[i][j] = i == j ? 1 : 0;
+		for (std::size_t k = 0; k + 1 < N; k++)
+		{
+			double v[N] = {}, norm = 0;
+			for (std::size_t i = k; i < N; i++)
+			{
+				v[i] = a[i][k];
+				norm += v[i] * v[i];
+			}
+			norm = std::sqrt(norm);
+			v[k] += v[k] < 0 ? -norm : norm;
+			double vv = 0;
+			for (std::size_t i = k; i < N; i++)
+				vv += v[i] * v[i];
+			if (vv == 0)
+				continue;
+			for (std::size_t j = 0; j < N; j++)
+			{
+				double dot = 0;
+				for (std::size_t i = k; i < N; i++)
+					dot += v[i] * a[i][j];
+				for (std::size_t i = k; i < N; i++)
+					a[i][j] -= 2 * dot / vv * v[i];
+				dot = 0;
+				for (std::size_t i = k; i < N; i++)
+					dot += q[j][i] * v[i];
+				for (std::size_t i = k; i < N; i++)
+					q[j][i] -= 2 * dot / vv * v[i];
+			}
+		}
+	}
+
+	SingularValueDecomposition generalSvd(const Mat2x2& m)
+	{
+		double u[2][2] = { { m[0], m[1] }, { m[2], m[3] } }, v[2][2], sigma[2];
+		jacobiSvd<2>(u, v, sigma);
+		const int first = sigma[0] >= sigma[1] ? 0 : 1, second = 1 - first;
+		SingularValueDecomposition result;
+		result.u = Mat2x2(u[0][first], u[0][second], u[1][first], u[1][second]);
+		result.sigma1 = sigma[first];
+		result.sigma2 = sigma[second];
+		result.v = Mat2x2(v[0][first], v[0][second], v[1][first], v[1][second]);
+		return result;
+	}
+
+	PolarDecomposition generalPolar(const Mat2x2& m)
+	{
+		const SingularValueDecomposition d = generalSvd(m);
+		const Mat2x2& u = d.u;
+		const Mat2x2& v = d.v;
+		PolarDecomposition result;
+		result.r = Mat2x2(u[0] * v[0] + u[1] * v[1], u[0] * v[2] + u[1] * v[3],
+			u[2] * v[0] + u[3] * v[1], u[2] * v[2] + u[3] * v[3]);
+		const double s01 = d.sigma1 * v[0] * v[2] + d.sigma2 * v[1] * v[3];
+		result.s = Mat2x2(d.sigma1 * v[0] * v[0] + d.sigma2 * v[1] * v[1], s01,
+			s01, d.sigma1 * v[2] * v[2] + d.sigma2 * v[3] * v[3]);
+		return result;
+	}
+
+	QRDecomposition generalQr(const Mat2x2& m)
+	{
+		double a[2][2] = { { m[0], m[1] }, { m[2], m[3] } }, q[2][2];
+		householderQr<2>(a, q);
+		QRDecomposition result;
+		result.q = Mat2x2(q[0][0], q[0][1], q[1][0], q[1][1]);
+		result.r = Mat2x2(a[0][0], a[0][1], 0, a[1][1]);
+		return result;
+	}
+
+	EigenDecomposition generalSymmetricEigen(const Mat2x2& m)
+	{
+		double a[2][2] = { { m[0], m[1] }, { m[2], m[3] } }, v[2][2], lambda[2];
+		jacobiEigen<2>(a, v, lambda);
+		const int first = lambda[0] >= lambda[1] ? 0 : 1, second = 1 - first;
+		EigenDecomposition result;
+		result.lambda1 = lambda[first];
+		result.lambda2 = lambda[second];
+		result.vectors = Mat2x2(v[0][first], v[0][second], v[1][first], v[1][second]);
+		return result;
+	}
+
+	/*
+	* user-027: the batched decompositions on every instruction set level
+		this CPU supports, against the general-purpose path in the first
+		row. The scalar row is the closed form one matrix at a time
+	*/
+	void benchDecompositions(std::ostream& out)
+	{
+		const std::size_t n = 1 << 16;
+		const std::vector<Mat2x2> input = generate(Distribution::Uniform, n, 27);
+		const std::vector<Mat2x2> symmetric = generate(Distribution::Symmetric, n, 27);
+		std::vector<SingularValueDecomposition> svds(n);
+		std::vector<PolarDecomposition> polars(n);
+		std::vector<QRDecomposition> qrs(n);
+		std::vector<EigenDecomposition> eigens(n);
+		auto levels = [&](const char* title, const char* general, auto decompose, void (*run)(const BatchKernels&, const Mat2x2*, void*, std::size_t),
+			const Mat2x2* in, auto* results)
+		{
+			Table table(out, title);
+			table.row(general, nanosecondsPer(n, [&]()
+			{
+				for (std::size_t i = 0; i < n; i++)
+					results[i] = decompose(in[i]);
+			}));
+			for (int level = static_cast<int>(IsaLevel::Scalar); level <= static_cast<int>(detectIsa()); level++)
+			{
+				const BatchKernels& k = kernels(static_cast<IsaLevel>(level));
+				table.row(isaName(k.level), nanosecondsPer(n, [&]() { run(k, in, results, n); }));
+			}
+		};
+		levels("decompositions: svd", "general, one-sided Jacobi", generalSvd, [](const BatchKernels& k, const Mat2x2* in, void* o, std::size_t n)
+			{ k.svd(in, static_cast<SingularValueDecomposition*>(o), n); }, input.data(), svds.data());
+		levels("decompositions: polar", "general, from one-sided Jacobi", generalPolar, [](const BatchKernels& k, const Mat2x2* in, void* o, std::size_t n)
+			{ k.polar(in, static_cast<PolarDecomposition*>(o), n); }, input.data(), polars.data());
+		levels("decompositions: qr", "general, Householder", generalQr, [](const BatchKernels& k, const Mat2x2* in, void* o, std::size_t n)
+			{ k.qr(in, static_cast<QRDecomposition*>(o), n); }, input.data(), qrs.data());
+		levels("decompositions: symmetricEigen", "general, Jacobi sweeps", generalSymmetricEigen, [](const BatchKernels& k, const Mat2x2* in, void* o, std::size_t n)
+			{ k.symmetricEigen(in, static_cast<EigenDecomposition*>(o), n); }, symmetric.data(), eigens.data());
+		sink = sink + svds[n - 1].sigma1 + polars[n - 1].s[0] + qrs[n - 1].r[0] + eigens[n - 1].lambda1;
+	}
+
+	/*
+	* user-028: condition numbers on every instruction set level, and the
+		classification of a batch on the active one
+	*/
+	void benchConditioning(std::ostream& out)
+	{
+		const std::size_t n = 1 << 16;
+		const std::vector<Mat2x2> input = generate(Distribution::Uniform, n, 28);
+		std::vector<double> conditions(n);
+		std::vector<ConditionClass> classes(n);
+		Table table(out, "conditioning: condition numbers");
+		for (int level = static_cast<int>(IsaLevel::Scalar); level <= static_cast<int>(detectIsa()); level++)
+		{
+			const BatchKernels& k = kernels(static_cast<IsaLevel>(level));
+			table.row(isaName(k.level), nanosecondsPer(n, [&]() { k.conditionNumber(input.data(), conditions.data(), n); }));
+		}
+		table.row(std::string("classifyConditioning, ") + isaName(activeIsa()),
+			nanosecondsPer(n, [&]() { classifyConditioning(input.data(), classes.data(), n); }));
+		sink = sink + conditions[n - 1] + static_cast<double>(classes[n - 1]);
+	}
+
+	//the baseline of the queue benchmark, a ring under one mutex
+	template<typename T>
+	class LockedQueue
+	{
+	private:
+		std::mutex lock;
+		std::vector<T> slots;
+		std::size_t head;
+		std::size_t count;
+	public:
+		explicit LockedQueue(std::size_t capacity) : slots(capacity), head{ 0 }, count{ 0 } {}
+
+		bool tryPush(const T& value)
+		{
+			std::lock_guard<std::mutex> guard(this->lock);
+			if (this->count == this->slots.size())
+				return false;
+			this->slots[(this->head + this->count++) % this->slots.size()] = value;
+			return true;
+		}
+
+		bool tryPop(T& value)
+		{
+			std::lock_guard<std::mutex> guard(this->lock);
+			if (this->count == 0)
+				return false;
+			value = this->slots[this->head];
+			this->head = (this->head + 1) % this->slots.size();
+			this->count--;
+			return true;
+		}
+	};
+
+	/*
+	* threads that each push a matrix and pop one until the queue has
+		moved pairs matrices in total
+
+	* @return the nanoseconds per push and pop
+	*/
+	template<typename Queue>
+	double queuePairs(Queue& queue, unsigned threads, std::size_t pairs)
+	{
+		return nanosecondsPer(pairs, [&]()
+		{
+			std::vector<std::thread> pool;
+			for (unsigned t = 0; t < threads; t++)
+			{
+				pool.emplace_back([&]()
+				{
+					Mat2x2 m(1, 2, 3, 4);
+					for (std::size_t i = 0; i < pairs / threads; i++)
+					{
+						push(queue, m);
+						pop(queue, m);
+					}
+					sink = sink + m[0];
+				});
+			}
+			for (std::thread& thread : pool)
+				thread.join();
+		}, 3);
+	}
+
+	/*
+	* user-032: MatMpmcQueue against a mutex-protected ring with 1 to 64
+		threads that all produce and consume
+	*/
+	void benchQueues(std::ostream& out)
+	{
+		const std::size_t pairs = 1 << 18;
+		out << "\nqueues on " << std::thread::hardware_concurrency() << " hardware threads\n";
+		for (unsigned threads = 1; threads <= 64; threads *= 2)
+		{
+			MatMpmcQueue lockFree(1024);
+			LockedQueue<Mat2x2> locked(1024);
+			Table table(out, ("queues: " + std::to_string(threads) + " threads pushing and popping").c_str(), "ns/pair");
+			table.row("mutex", queuePairs(locked, threads, pairs));
+			table.row("MatMpmcQueue", queuePairs(lockFree, threads, pairs));
+		}
+	}
+
+	//a matrix of the given kind built from the values of m
+	Mat2x2 ofKind(MatKind kind, const Mat2x2& m)
+	{
+		const double a = 1 + std::abs(m[0]), d = 1 + std::abs(m[3]);
+		switch (kind)
+		{
+		case MatKind::Diagonal:
+			return Mat2x2(a, 0, 0, d);
+		case MatKind::Rotation:
+		{
+			const double length = std::hypot(m[0], m[2]);
+			return Mat2x2(m[0] / length, -m[2] / length, m[2] / length, m[0] / length);
+		}
+		case MatKind::UpperTriangular:
+			return Mat2x2(a, m[1], 0, d);
+		case MatKind::LowerTriangular:
+			return Mat2x2(a, 0, m[2], d);
+		default:
+			return m;
+		}
+	}
+
+	/*
+	* user-033: processFile() on a 64 MB file, through io_uring and
+		through the threaded fstream path. The file is written just
+		before, so it is read from the page cache
+	*/
+	void benchFiles(std::ostream& out)
+	{
+		const std::size_t n = 2 * 1024 * 1024;
+		const std::vector<Mat2x2> input = generate(Distribution::Uniform, n, 33);
+		writeMatrixFile("bench_in.bin", input.data(), n);
+		for (BatchOperation operation : { BatchOperation::Multiply, BatchOperation::Inverse })
+		{
+			Table table(out, operation == BatchOperation::Multiply ? "files: Multiply" : "files: Inverse");
+			for (bool ioUring : { false, true })
+			{
+				FileBatchOptions options;
+				options.ioUring = ioUring;
+				table.row(ioUring ? "io_uring (threads if refused)" : "threads, blocking fstream", nanosecondsPer(n, [&]()
+				{
+					sink = sink + processFileAsync("bench_in.bin", "bench_out.bin", operation, Mat2x2(1, 2, 3, 4), options).get();
+				}, 3), std::to_string(std::thread::hardware_concurrency()) + " hardware threads");
+			}
+		}
+		std::remove("bench_in.bin");
+		std::remove("bench_out.bin");
+	}
+
+	/*
+	* user-034: the structured kernels against the general ones, scalar
+		and dispatched, for every pair of kinds with a kernel of its own
+	*/
+	void benchStructured(std::ostream& out)
+	{
+		const std::size_t n = 1 << 16;
+		const std::vector<Mat2x2> lhsValues = generate(Distribution::Uniform, n, 34);
+		const std::vector<Mat2x2> rhsValues = generate(Distribution::Uniform, n, 35);
+		std::vector<Mat2x2> lhs(n), rhs(n), result(n);
+		const BatchKernels& batch = kernels();
+		const std::string dispatched = std::string("kernels().multiply, ") + isaName(batch.level);
+		const MatKind pairs[][2] = { { MatKind::Diagonal, MatKind::Diagonal }, { MatKind::Diagonal, MatKind::General },
+			{ MatKind::General, MatKind::Diagonal }, { MatKind::Rotation, MatKind::Rotation },
+			{ MatKind::UpperTriangular, MatKind::UpperTriangular }, { MatKind::LowerTriangular, MatKind::LowerTriangular } };
+		const char* names[] = { "diagonal", "rotation", "symmetric", "upper", "lower", "general" };
+		for (const auto& pair : pairs)
+		{
+			for (std::size_t i = 0; i < n; i++)
+			{
+				lhs[i] = ofKind(pair[0], lhsValues[i]);
+				rhs[i] = ofKind(pair[1], rhsValues[i]);
+			}
+			Table table(out, (std::string("structured: multiply ") + names[static_cast<int>(pair[0])] + " * " + names[static_cast<int>(pair[1])]).c_str());
+			table.row("multiply(General, General)", nanosecondsPer(n, [&]()
+			{
+				multiply(lhs.data(), MatKind::General, rhs.data(), MatKind::General, result.data(), n);
+			}));
+			table.row(dispatched, nanosecondsPer(n, [&]() { batch.multiply(lhs.data(), rhs.data(), result.data(), n); }));
+			table.row("multiply(kinds)", nanosecondsPer(n, [&]()
+			{
+				multiply(lhs.data(), pair[0], rhs.data(), pair[1], result.data(), n);
+			}));
+			sink = sink + result[n - 1][0];
+		}
+
+		for (MatKind kind : { MatKind::Diagonal, MatKind::Rotation })
+		{
+			for (std::size_t i = 0; i < n; i++)
+				lhs[i] = ofKind(kind, lhsValues[i]);
+			Table table(out, (std::string("structured: invert ") + names[static_cast<int>(kind)]).c_str());
+			table.row("Mat2x2::inverse()", nanosecondsPer(n, [&]()
+			{
+				for (std::size_t i = 0; i < n; i++)
+					result[i] = lhs[i].inverse();
+			}));
+			table.row(std::string("kernels().inverse, ") + isaName(batch.level), nanosecondsPer(n, [&]()
+			{
+				batch.inverse(lhs.data(), result.data(), n);
+			}));
+			table.row("invert(kind)", nanosecondsPer(n, [&]() { invert(lhs.data(), kind, result.data(), n); }));
+			sink = sink + result[n - 1][0];
+		}
+	}
+
+	/*
+	* user-035: every batch kernel with its own code per instruction set
+		level, on every level this CPU supports, with both arithmetics
+	*/
+	void benchDispatch(std::ostream& out)
+	{
+		//4096 matrices stay in L2, larger batches time the memory bus on every level
+		const std::size_t n = 1 << 12, repeats = 64;
+		const std::vector<Mat2x2> lhs = generate(Distribution::Uniform, n, 36);
+		const std::vector<Mat2x2> rhs = generate(Distribution::Uniform, n, 37);
+		std::vector<Mat2x2> result(n);
+		std::vector<double> dets(n), traces(n);
+		std::vector<Eigenvalues> roots(n);
+		const char* names[] = { "add", "subtract", "multiply", "inverse", "determinantTrace", "eigenvalues" };
+		for (int kernel = 0; kernel < 6; kernel++)
+		{
+			Table table(out, (std::string("dispatch: ") + names[kernel]).c_str());
+			for (Arithmetic arithmetic : { Arithmetic::Naive, Arithmetic::Compensated })
+			{
+				//add and subtract do not round differently under either arithmetic
+				if (arithmetic == Arithmetic::Compensated && kernel < 2)
+					break;
+				for (int level = static_cast<int>(IsaLevel::Scalar); level <= static_cast<int>(detectIsa()); level++)
+				{
+					const BatchKernels& k = kernels(static_cast<IsaLevel>(level), arithmetic);
+					const std::string name = std::string(isaName(k.level)) + (arithmetic == Arithmetic::Naive ? ", naive" : ", compensated");
+					table.row(name, nanosecondsPer(n * repeats, [&]()
+					{
+						for (std::size_t r = 0; r < repeats; r++)
+							switch (kernel)
+							{
+							case 0:
+								k.add(lhs.data(), rhs.data(), result.data(), n);
+								break;
+							case 1:
+								k.subtract(lhs.data(), rhs.data(), result.data(), n);
+								break;
+							case 2:
+								k.multiply(lhs.data(), rhs.data(), result.data(), n);
+								break;
+							case 3:
+								k.inverse(lhs.data(), result.data(), n);
+								break;
+							case 4:
+								k.determinantTrace(lhs.data(), dets.data(), traces.data(), n);
+								break;
+							default:
+								k.eigenvalues(lhs.data(), roots.data(), n);
+							}
+					}));
+				}
+			}
+		}
+		sink = sink + result[n - 1][0] + dets[n - 1] + roots[n - 1].re1;
+	}
+
+	/*
+	* user-036: the certified interval results against the double ones
+		they enclose, and against re-running the double path in long
+		double to check it
+	*/
+	void benchIntervals(std::ostream& out)
+	{
+		//inverse() throws when |det| <= e^-6, keep the matrices it inverts
+		std::vector<Mat2x2> input;
+		for (const Mat2x2& m : generate(Distribution::Uniform, 1 << 15, 36))
+			if (std::abs(m.determinant(Arithmetic::Naive)) > 0.01 && input.size() < (1 << 14))
+				input.push_back(m);
+		const std::size_t n = input.size();
+		std::vector<IntervalMat2x2> intervals(input.begin(), input.end());
+		double total = 0;
+
+		Table determinants(out, "intervals: determinant");
+		determinants.row("Mat2x2::determinant(Naive)", nanosecondsPer(n, [&]()
+		{
+			for (const Mat2x2& m : input)
+				total += m.determinant(Arithmetic::Naive);
+		}));
+		determinants.row("Mat2x2::determinant(Compensated)", nanosecondsPer(n, [&]()
+		{
+			for (const Mat2x2& m : input)
+				total += m.determinant(Arithmetic::Compensated);
+		}));
+		determinants.row("double, then long double re-check", nanosecondsPer(n, [&]()
+		{
+			for (const Mat2x2& m : input)
+			{
+				const long double exact = static_cast<long double>(m[0]) * m[3] - static_cast<long double>(m[1]) * m[2];
+				total += m.determinant(Arithmetic::Naive) - static_cast<double>(exact);
+			}
+		}));
+		determinants.row("certifiedDeterminant", nanosecondsPer(n, [&]()
+		{
+			for (const Mat2x2& m : input)
+				total += certifiedDeterminant(m).upper();
+		}));
+		determinants.row("IntervalMat2x2::determinant", nanosecondsPer(n, [&]()
+		{
+			for (const IntervalMat2x2& m : intervals)
+				total += m.determinant().upper();
+		}));
+
+		Table inverses(out, "intervals: inverse");
+		inverses.row("Mat2x2::inverse", nanosecondsPer(n, [&]()
+		{
+			for (Mat2x2& m : input)
+				total += m.inverse()[0];
+		}));
+		inverses.row("IntervalMat2x2::inverse", nanosecondsPer(n, [&]()
+		{
+			for (const IntervalMat2x2& m : intervals)
+				total += m.inverse()[0].upper();
+		}));
+
+		Table roots(out, "intervals: eigenvalues");
+		roots.row("eigenvalues(Mat2x2)", nanosecondsPer(n, [&]()
+		{
+			for (const Mat2x2& m : input)
+				total += eigenvalues(m).re1;
+		}));
+		roots.row("eigenvalues(IntervalMat2x2)", nanosecondsPer(n, [&]()
+		{
+			for (const IntervalMat2x2& m : intervals)
+				total += eigenvalues(m).re1.upper();
+		}));
+		sink = sink + total;
+	}
+
+	/*
+	* user-037: Naive against Compensated determinants, products and
+		inverses, through the policy (one relaxed atomic load per call)
+		and with the arithmetic passed per call, with the worst relative
+		error of the determinant on near-singular matrices
+	*/
+	void benchPolicy(std::ostream& out)
+	{
+		const std::size_t n = 1 << 14;
+		std::vector<Mat2x2> input;
+		for (const Mat2x2& m : generate(Distribution::Uniform, 1 << 15, 37))
+			if (std::abs(m.determinant(Arithmetic::Naive)) > 0.01 && input.size() < n)
+				input.push_back(m);
+		const std::vector<Mat2x2> nearSingular = generate(Distribution::NearSingular, n, 37);
+		auto worstError = [&](double (*det)(const Mat2x2&))
+		{
+			double worst = 0;
+			for (const Mat2x2& m : nearSingular)
+			{
+				const double exact = certifiedDeterminant(m).midpoint();
+				if (exact != 0)
+					worst = std::max(worst, std::abs(det(m) - exact) / std::abs(exact));
+			}
+			char note[64];
+			std::snprintf(note, sizeof note, "worst relative error %.1e", worst);
+			return std::string(note);
+		};
+		double total = 0;
+
+		Table determinants(out, "policy: determinant");
+		determinants.row("determinant(Naive)", nanosecondsPer(input.size(), [&]()
+		{
+			for (const Mat2x2& m : input)
+				total += m.determinant(Arithmetic::Naive);
+		}), worstError([](const Mat2x2& m) { return m.determinant(Arithmetic::Naive); }));
+		Mat2x2::setArithmetic(Arithmetic::Naive);
+		determinants.row("determinant(), policy Naive", nanosecondsPer(input.size(), [&]()
+		{
+			for (const Mat2x2& m : input)
+				total += m.determinant();
+		}));
+		determinants.row("determinant(Compensated)", nanosecondsPer(input.size(), [&]()
+		{
+			for (const Mat2x2& m : input)
+				total += m.determinant(Arithmetic::Compensated);
+		}), worstError([](const Mat2x2& m) { return m.determinant(Arithmetic::Compensated); }));
+		Mat2x2::setArithmetic(Arithmetic::Compensated);
+		determinants.row("determinant(), policy Compensated", nanosecondsPer(input.size(), [&]()
+		{
+			for (const Mat2x2& m : input)
+				total += m.determinant();
+		}));
+		Mat2x2::setArithmetic(Arithmetic::Naive);
+		determinants.row("long double ad - bc", nanosecondsPer(input.size(), [&]()
+		{
+			for (const Mat2x2& m : input)
+				total += static_cast<double>(static_cast<long double>(m[0]) * m[3] - static_cast<long double>(m[1]) * m[2]);
+		}), worstError([](const Mat2x2& m)
+		{
+			return static_cast<double>(static_cast<long double>(m[0]) * m[3] - static_cast<long double>(m[1]) * m[2]);
+		}));
+
+		Table products(out, "policy: operator*=");
+		for (Arithmetic arithmetic : { Arithmetic::Naive, Arithmetic::Compensated })
+		{
+			const char* name = arithmetic == Arithmetic::Naive ? "Naive" : "Compensated";
+			Mat2x2::setArithmetic(arithmetic);
+			products.row(std::string("operator*=, policy ") + name, nanosecondsPer(input.size(), [&]()
+			{
+				Mat2x2 product(1, 0, 0, 1);
+				for (Mat2x2& m : input)
+					product *= m;
+				total += product[0];
+			}));
+			products.row(std::string("multiplyBy(") + name + ")", nanosecondsPer(input.size(), [&]()
+			{
+				Mat2x2 product(1, 0, 0, 1);
+				for (Mat2x2& m : input)
+					product.multiplyBy(m, arithmetic);
+				total += product[0];
+			}));
+		}
+		Mat2x2::setArithmetic(Arithmetic::Naive);
+
+		Table inverses(out, "policy: inverse");
+		for (Arithmetic arithmetic : { Arithmetic::Naive, Arithmetic::Compensated })
+		{
+			const char* name = arithmetic == Arithmetic::Naive ? "Naive" : "Compensated";
+			Mat2x2::setArithmetic(arithmetic);
+			inverses.row(std::string("inverse(), policy ") + name, nanosecondsPer(input.size(), [&]()
+			{
+				for (Mat2x2& m : input)
+					total += m.inverse()[0];
+			}));
+			inverses.row(std::string("inverse(") + name + ")", nanosecondsPer(input.size(), [&]()
+			{
+				for (Mat2x2& m : input)
+					total += m.inverse(arithmetic)[0];
+			}));
+		}
+		Mat2x2::setArithmetic(Arithmetic::Naive);
+		sink = sink + total;
+	}
+
+	/*
+	* user-038: compression ratios, scans feeding determinantTrace and
+		random access, against a plain vector, for the mix the archives
+		hold (70% identity, diagonal and symmetric), the same mix in runs
+		of one kind, random General matrices and quantised diagonals
+	*/
+	void benchCompressed(std::ostream& out)
+	{
+		const std::size_t n = 1 << 18;
+		const std::vector<Mat2x2> values = generate(Distribution::Uniform, n, 38);
+		std::vector<Mat2x2> mix(n), quantised(n);
+		for (std::size_t i = 0; i < n; i++)
+		{
+			const double a = values[i][0], b = values[i][1], d = values[i][3];
+			const std::uint32_t pick = static_cast<std::uint32_t>(i * 2654435761u) % 30;
+			mix[i] = pick < 7 ? Mat2x2(1, 0, 0, 1) : pick < 14 ? Mat2x2(a, 0, 0, d) : pick < 21 ? Mat2x2(a, b, b, d) : values[i];
+			quantised[i] = Mat2x2(1 + double(i % 1024) / 1024, 0, 0, 1 - double(i % 512) / 1024);
+		}
+		std::vector<Mat2x2> runs = mix;
+		std::stable_sort(runs.begin(), runs.end(), [](const Mat2x2& x, const Mat2x2& y) { return storedKind(x) < storedKind(y); });
+		const std::pair<const char*, const std::vector<Mat2x2>*> datasets[] = { { "70% identity/diagonal/symmetric", &mix },
+			{ "the same in runs of one kind", &runs }, { "random General", &values }, { "quantised diagonals", &quantised } };
+
+		std::vector<double> dets(n), traces(n);
+		std::vector<std::size_t> indices(n);
+		for (std::size_t i = 0; i < n; i++)
+			indices[i] = static_cast<std::size_t>(i * 2654435761u) % n;
+		for (const auto& dataset : datasets)
+		{
+			const std::vector<Mat2x2>& matrices = *dataset.second;
+			Table table(out, (std::string("compressed: ") + dataset.first).c_str());
+			table.row("std::vector, determinantTrace", nanosecondsPer(n, [&]()
+			{
+				kernels().determinantTrace(matrices.data(), dets.data(), traces.data(), n);
+			}));
+			table.row("std::vector, operator[]", nanosecondsPer(n, [&]()
+			{
+				double total = 0;
+				for (std::size_t i : indices)
+					total += matrices[i][0];
+				sink = sink + total;
+			}));
+			for (bool xorFields : { false, true })
+			{
+				CompressedMatrices archive(xorFields, 256);
+				archive.append(matrices.data(), n);
+				char ratio[64];
+				std::snprintf(ratio, sizeof ratio, "%.2fx smaller", double(n * sizeof(Mat2x2)) / archive.compressedBytes());
+				const std::string name = xorFields ? "xor" : "plain";
+				table.row("scan, " + name + ", determinantTrace", nanosecondsPer(n, [&]()
+				{
+					std::size_t done = 0;
+					archive.scan([&](const Mat2x2* m, std::size_t count)
+					{
+						kernels().determinantTrace(m, dets.data() + done, traces.data() + done, count);
+						done += count;
+					});
+				}), ratio);
+				table.row("operator[], " + name, nanosecondsPer(n, [&]()
+				{
+					double total = 0;
+					for (std::size_t i : indices)
+						total += archive[i][0];
+					sink = sink + total;
+				}));
+			}
+			sink = sink + dets[n - 1] + traces[n - 1];
+		}
+	}
+
+	/*
+	* user-039: Inverse and Product of 1M matrices on one thread, on
+		forked local workers and on a loopback ShardServer. The speedup of
+		the local rows is bounded by the hardware threads; the loopback rows
+		price the wire, a remote host adds its own latency on top
+	*/
+	void benchSharding(std::ostream& out)
+	{
+		const std::size_t n = 1 << 20;
+		const std::vector<Mat2x2> values = generate(Distribution::Uniform, n, 39);
+		//products of rotations neither overflow nor fall into subnormals
+		std::vector<Mat2x2> rotations(n), results(n);
+		for (std::size_t i = 0; i < n; i++)
+			rotations[i] = Mat2x2(std::cos(values[i][0]), -std::sin(values[i][0]), std::sin(values[i][0]), std::cos(values[i][0]));
+		ShardServer server;
+		std::thread serving(&ShardServer::serve, &server);
+		const std::string endpoint = "127.0.0.1:" + std::to_string(server.port());
+		const std::string threads = std::to_string(std::thread::hardware_concurrency()) + " hardware threads";
+		for (ShardOperation operation : { ShardOperation::Inverse, ShardOperation::Product })
+		{
+			const bool inverse = operation == ShardOperation::Inverse;
+			const std::vector<Mat2x2>& input = inverse ? values : rotations;
+			Table table(out, inverse ? "sharding: Inverse" : "sharding: Product");
+			table.row("one thread", nanosecondsPer(n, [&]()
+			{
+				if (inverse)
+					kernels().inverse(input.data(), results.data(), n);
+				else
+				{
+					Mat2x2 product(1, 0, 0, 1);
+					for (const Mat2x2& m : input)
+					{
+						Mat2x2 factor = m;
+						product *= factor;
+					}
+					sink = sink + product[0];
+				}
+			}, 3), threads);
+			for (std::size_t workers : { 1, 2, 4 })
+			{
+				ShardOptions options;
+				options.localWorkers = workers;
+				table.row(std::to_string(workers) + " local workers", nanosecondsPer(n, [&]()
+				{
+					sink = sink + runSharded(operation, input.data(), results.data(), n, options).reduction[0];
+				}, 3));
+			}
+			for (std::size_t connections : { 1, 2 })
+			{
+				ShardOptions options;
+				options.endpoints.assign(connections, endpoint);
+				table.row(std::to_string(connections) + " loopback connections", nanosecondsPer(n, [&]()
+				{
+					sink = sink + runSharded(operation, input.data(), results.data(), n, options).reduction[0];
+				}, 3));
+			}
+			sink = sink + results[n - 1][0];
+		}
+		server.stop();
+		serving.join();
+	}
+
+	/*
+	* user-040: one step of a window over a stream, push() and product(),
+		against multiplying the last W matrices again. Recomputing is
+		timed on 64 steps, the window on 2W steps so every matrix goes
+		through a flip; the note is the slowest single step, the flip,
+		timed in a separate pass
+	*/
+	void benchSlidingWindow(std::ostream& out)
+	{
+		const std::size_t steps = 2 * 1000 * 1000;
+		const std::vector<Mat2x2> values = generate(Distribution::Uniform, steps, 40);
+		//products of rotations neither overflow nor fall into subnormals
+		std::vector<Mat2x2> stream(steps);
+		for (std::size_t i = 0; i < steps; i++)
+			stream[i] = Mat2x2(std::cos(values[i][0]), -std::sin(values[i][0]), std::sin(values[i][0]), std::cos(values[i][0]));
+		for (std::size_t window : { 10, 1000, 1000 * 1000 })
+		{
+			Table table(out, ("sliding window: W = " + std::to_string(window)).c_str(), "ns/step");
+			const std::size_t recomputed = 64;
+			table.row("multiply the last W again", nanosecondsPer(recomputed, [&]()
+			{
+				for (std::size_t step = window; step < window + recomputed; step++)
+				{
+					Mat2x2 product(1, 0, 0, 1);
+					for (std::size_t i = step - window; i < step; i++)
+					{
+						Mat2x2 factor = stream[i];
+						product *= factor;
+					}
+					sink = sink + product[0];
+				}
+			}, 3));
+			for (bool withSum : { false, true })
+			{
+				SlidingWindow recent(window);
+				std::size_t next = 0;
+				for (; next < window; next++)
+					recent.push(stream[next]);
+				auto step = [&]()
+				{
+					recent.push(stream[next++ % steps]);
+					double total = recent.product()[0];
+					if (withSum)
+						total += recent.sum()[0];
+					return total;
+				};
+				const double time = nanosecondsPer(2 * window, [&]()
+				{
+					double total = 0;
+					for (std::size_t i = 0; i < 2 * window; i++)
+						total += step();
+					sink = sink + total;
+				}, 3);
+				double slowest = 0;
+				for (std::size_t i = 0; i < 2 * window; i++)
+				{
+					const auto start = std::chrono::steady_clock::now();
+					sink = sink + step();
+					const std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+					slowest = std::max(slowest, elapsed.count());
+				}
+				char note[64];
+				std::snprintf(note, sizeof note, "slowest step %.1f us", slowest / 1000);
+				table.row(withSum ? "SlidingWindow, product() and sum()" : "SlidingWindow, product()", time, note);
+			}
+		}
+	}
+
+	struct Benchmark
+	{
+		const char* name;
+		void (*run)(std::ostream&);
+	};
+
+	const Benchmark benchmarks[] = {
+		{ "arena", benchArena },
+		{ "decompositions", benchDecompositions },
+		{ "conditioning", benchConditioning },
+		{ "queues", benchQueues },
+		{ "files", benchFiles },
+		{ "structured", benchStructured },
+		{ "dispatch", benchDispatch },
+		{ "intervals", benchIntervals },
+		{ "policy", benchPolicy },
+		{ "compressed", benchCompressed },
+		{ "sharding", benchSharding },
+		{ "window", benchSlidingWindow },
+	};
+}
+
+/*
+* to run the benchmarks and print their tables
+
+* @param  out - where the tables are printed
+* @param  name - the benchmark to run, all of them when empty
+*/
+void runBenchmarks(std::ostream& out, const std::string& name)
+{
+	bool found = false;
+	for (const Benchmark& benchmark : benchmarks)
+	{
+		if (!name.empty() && name != benchmark.name)
+			continue;
+		found = true;
+		benchmark.run(out);
+	}
+	if (!found)
+		throw std::invalid_argument("Invalid arguments");
+}
@@ -0,0 +1,15 @@
+#ifndef BENCH_H
+#define BENCH_H
+#include<iostream>
+#include<string>
+
+/*
+* the timing driver behind "driver --bench [name]"
+
+* every benchmark prints a small table, one line per variant, with
+	the time per matrix (or per request) of the fastest of a few runs
+	and its speedup over the first line of the table. Build with the
+	flags you deploy with, the numbers mean nothing in a debug build.
+*/
+void runBenchmarks(std::ostream&, const std::string& = "");
+#endif
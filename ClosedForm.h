@@ -0,0 +1,219 @@
+#ifndef CLOSEDFORM_H
+#define CLOSEDFORM_H
+#include<cfloat>
+#include<cmath>
+#include<cstdint>
+#include<cstring>
+
+/*
+* trig-free, branch-free closed forms of the 2x2 decompositions and the
+	condition number, shared by the single-matrix functions in
+	Decomposition.cpp and Conditioning.cpp and the batch kernels in
+	CpuDispatch.cpp
+
+* every closed form is a template on the lane type V: double here, two,
+	four or eight doubles in CpuDispatch.cpp. V only needs + - * /,
+	unary -, a constructor from double and the functions below, so one
+	straight line of arithmetic and selects computes one matrix per
+	lane on every instruction set level. Outputs are written through
+	references, vectors are never passed or returned by value from the
+	templates.
+
+* m = rot(phi) * diag(sx, sy) * rot(theta) is read off the rotation
+	part (e, h) and the reflection part (f, g) of the matrix. Their
+	angles a2 and a1 are never computed: phi = (a1 + a2) / 2 comes from
+	the half-angle formulas applied to the unit vector of angle a1 + a2,
+	and theta = a2 - phi from one complex product. The matrix is first
+	scaled by a power of two, so no square overflows or underflows and
+	the scaling adds no rounding.
+*/
+
+//the operations of the closed forms on one double
+inline double sqrtOf(double x) { return std::sqrt(x); }
+inline double absOf(double x) { return std::abs(x); }
+//like the max and min instructions: the second operand when either is NaN
+inline double maxOf(double x, double y) { return x > y ? x : y; }
+inline double minOf(double x, double y) { return x < y ? x : y; }
+inline bool isEqual(double x, double y) { return x == y; }
+inline bool isLess(double x, double y) { return x < y; }
+inline bool isGreaterEqual(double x, double y) { return x >= y; }
+inline double select(bool mask, double x, double y) { return mask ? x : y; }
+
+//the exponent bits of a double
+const std::uint64_t exponentBits = 0x7FF0000000000000ULL;
+//the bits of 2^(1023 - e) are (2046 - e) << 52 for an exponent field e
+const std::uint64_t scaleBitsOffset = std::uint64_t(2046) << 52;
+
+/*
+* @param  largest - the largest absolute value of a matrix
+
+* @return a power of two that brings it below 4, and to at least 1
+	unless it is subnormal, so that dividing by it is exact
+*/
+inline double powerOfTwoScale(double largest)
+{
+	const double clamped = minOf(maxOf(largest, DBL_MIN), DBL_MAX / 2);
+	std::uint64_t bits;
+	std::memcpy(&bits, &clamped, sizeof bits);
+	bits = scaleBitsOffset - (bits & exponentBits);
+	double scale;
+	std::memcpy(&scale, &bits, sizeof scale);
+	return scale;
+}
+
+/*
+* the angle form m = rot(phi) * diag(sx, sy) * rot(theta), sx >= |sy|,
+	with sx and sy still multiplied by scale
+*/
+template<typename V>
+struct ClosedRotationForm
+{
+	V cosPhi, sinPhi;
+	V sx, sy;
+	V cosTheta, sinTheta;
+	V scale;
+};
+
+template<typename V>
+inline void closedRotationForm(const V& a, const V& b, const V& c, const V& d, ClosedRotationForm<V>& rf)
+{
+	const V zero(0.0), half(0.5), one(1.0);
+	rf.scale = powerOfTwoScale(maxOf(maxOf(absOf(a), absOf(b)), maxOf(absOf(c), absOf(d))));
+	const V as = a * rf.scale, bs = b * rf.scale, cs = c * rf.scale, ds = d * rf.scale;
+	const V e = (as + ds) * half, f = (as - ds) * half;
+	const V g = (cs + bs) * half, h = (cs - bs) * half;
+	const V q = sqrtOf(e * e + h * h);
+	const V r = sqrtOf(f * f + g * g);
+	//the unit vectors of angles a2 and a1, angle 0 when the part is zero
+	const V qSafe = select(isEqual(q, zero), one, q), rSafe = select(isEqual(r, zero), one, r);
+	const V c2 = select(isEqual(q, zero), one, e / qSafe), s2 = select(isEqual(q, zero), zero, h / qSafe);
+	const V c1 = select(isEqual(r, zero), one, f / rSafe), s1 = select(isEqual(r, zero), zero, g / rSafe);
+	//angle a1 + a2, then its half with cos(phi) >= 0, from whichever formula does not cancel
+	const V cosSum = c2 * c1 - s2 * s1;
+	const V sinSum = s2 * c1 + c2 * s1;
+	const V halfCos = sqrtOf((one + cosSum) * half);
+	const V halfSin = select(isGreaterEqual(sinSum, zero), one, -one) * sqrtOf((one - cosSum) * half);
+	rf.cosPhi = select(isGreaterEqual(cosSum, zero), halfCos, sinSum / (halfSin + halfSin));
+	rf.sinPhi = select(isGreaterEqual(cosSum, zero), sinSum / (halfCos + halfCos), halfSin);
+	rf.sx = q + r;
+	rf.sy = q - r;
+	//theta = a2 - phi
+	rf.cosTheta = c2 * rf.cosPhi + s2 * rf.sinPhi;
+	rf.sinTheta = s2 * rf.cosPhi - c2 * rf.sinPhi;
+}
+
+/*
+* o = u, sigma1, sigma2, v in the order of SingularValueDecomposition
+*/
+template<typename V>
+inline void svdClosedForm(const V& a, const V& b, const V& c, const V& d, V (&o)[10])
+{
+	const V zero(0.0), one(1.0);
+	ClosedRotationForm<V> rf;
+	closedRotationForm(a, b, c, d, rf);
+	//a negative second singular value is absorbed into the second column of v
+	const V sign = select(isLess(rf.sy, zero), -one, one);
+	o[0] = rf.cosPhi;
+	o[1] = -rf.sinPhi;
+	o[2] = rf.sinPhi;
+	o[3] = rf.cosPhi;
+	o[4] = rf.sx / rf.scale;
+	o[5] = absOf(rf.sy) / rf.scale;
+	o[6] = rf.cosTheta;
+	o[7] = sign * rf.sinTheta;
+	o[8] = -rf.sinTheta;
+	o[9] = sign * rf.cosTheta;
+}
+
+/*
+* o = r, s in the order of PolarDecomposition
+*/
+template<typename V>
+inline void polarClosedForm(const V& a, const V& b, const V& c, const V& d, V (&o)[8])
+{
+	const V zero(0.0), one(1.0);
+	ClosedRotationForm<V> rf;
+	closedRotationForm(a, b, c, d, rf);
+	//a reflection (det < 0) moves the sign of sy into r so that s stays positive semi-definite
+	const V sign = select(isLess(rf.sy, zero), -one, one);
+	const V sx = rf.sx / rf.scale, sy = absOf(rf.sy) / rf.scale;
+	const V cp = rf.cosPhi, sp = rf.sinPhi;
+	const V ct = rf.cosTheta, st = rf.sinTheta;
+	//r = rot(phi) * diag(1, sign) * rot(theta)
+	o[0] = cp * ct - sign * sp * st;
+	o[1] = -cp * st - sign * sp * ct;
+	o[2] = sp * ct + sign * cp * st;
+	o[3] = -sp * st + sign * cp * ct;
+	//s = rot(theta)^T * diag(sx, |sy|) * rot(theta)
+	o[4] = sx * ct * ct + sy * st * st;
+	o[5] = (sy - sx) * ct * st;
+	o[6] = o[5];
+	o[7] = sx * st * st + sy * ct * ct;
+}
+
+/*
+* o = q, r in the order of QRDecomposition, one Givens rotation
+*/
+template<typename V>
+inline void qrClosedForm(const V& a, const V& b, const V& c, const V& d, V (&o)[8])
+{
+	const V zero(0.0), one(1.0);
+	const V scale = powerOfTwoScale(maxOf(absOf(a), absOf(c)));
+	const V as = a * scale, cs = c * scale;
+	const V norm = sqrtOf(as * as + cs * cs) / scale;
+	//a zero first column is already upper triangular
+	const V safe = select(isEqual(norm, zero), one, norm);
+	const V cosine = select(isEqual(norm, zero), one, a / safe);
+	const V sine = select(isEqual(norm, zero), zero, c / safe);
+	o[0] = cosine;
+	o[1] = -sine;
+	o[2] = sine;
+	o[3] = cosine;
+	o[4] = norm;
+	o[5] = cosine * b + sine * d;
+	o[6] = zero;
+	o[7] = cosine * d - sine * b;
+}
+
+/*
+* o = lambda1, lambda2, vectors in the order of EigenDecomposition, c
+	is taken equal to b
+*/
+template<typename V>
+inline void symmetricEigenClosedForm(const V& a, const V& b, const V& d, V (&o)[6])
+{
+	const V zero(0.0), one(1.0);
+	const V scale = powerOfTwoScale(maxOf(maxOf(absOf(a), absOf(b)), absOf(d)));
+	//one Jacobi rotation annihilates b, t is the tangent of its angle and |t| <= 1
+	const V diff = (d - a) * scale, twice = (b + b) * scale;
+	const V length = absOf(diff) + sqrtOf(diff * diff + twice * twice);
+	const V safe = select(isEqual(b, zero), one, length);
+	const V t = select(isEqual(b, zero), zero, select(isLess(diff, zero), -twice, twice) / safe);
+	const V cs = one / sqrtOf(one + t * t);
+	const V sn = t * cs;
+	const V l1 = a - t * b, l2 = d + t * b;
+	const auto ordered = isGreaterEqual(l1, l2);
+	o[0] = select(ordered, l1, l2);
+	o[1] = select(ordered, l2, l1);
+	o[2] = select(ordered, cs, sn);
+	o[3] = select(ordered, sn, cs);
+	o[4] = select(ordered, -sn, cs);
+	o[5] = select(ordered, cs, -sn);
+}
+
+/*
+* the 2-norm condition number sigma1 / sigma2. With the matrix scaled by
+	a power of two, t = |m|_F^2 / (2 |det m|) and the condition number is
+	t + sqrt(t^2 - 1); infinite for a singular matrix, NaN for the zero
+	matrix
+*/
+template<typename V>
+inline void conditionClosedForm(const V& a, const V& b, const V& c, const V& d, V& condition)
+{
+	const V zero(0.0), one(1.0), two(2.0);
+	const V scale = powerOfTwoScale(maxOf(maxOf(absOf(a), absOf(b)), maxOf(absOf(c), absOf(d))));
+	const V as = a * scale, bs = b * scale, cs = c * scale, ds = d * scale;
+	const V t = (as * as + bs * bs + cs * cs + ds * ds) / (two * absOf(as * ds - bs * cs));
+	condition = t + sqrtOf(maxOf((t - one) * (t + one), zero));
+}
+#endif
@@ -0,0 +1,19 @@
+#ifndef COMPENSATED_H
+#define COMPENSATED_H
+#include<cmath>
+
+/*
+* x * y + z * w to within 2 ulps however much the two products cancel
+	(Kahan's algorithm): the rounding error of z * w is recovered
+	exactly with a fused multiply-add and added back at the end
+
+* std::fma is exact on every platform, but only fast where the CPU
+	has a fused multiply-add instruction
+*/
+inline double compensatedDot(double x, double y, double z, double w)
+{
+	const double p = z * w;
+	const double error = std::fma(z, w, -p);
+	return std::fma(x, y, p) + error;
+}
+#endif
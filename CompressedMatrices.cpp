@@ -0,0 +1,404 @@
+#include "CompressedMatrices.h"
+#include<algorithm>
+#include<cstring>
+#include<stdexcept>
+
+namespace
+{
+	static_assert(sizeof(Mat2x2) == 4 * sizeof(double), "Mat2x2 must be four packed doubles");
+
+	//the fields a kind stores, bit 0 for a up to bit 3 for d
+	const unsigned char storedFields[] = { 0x0, 0x9, 0x5, 0xB, 0xB, 0xD, 0xF };
+	//the number of fields a kind stores
+	const int fieldCounts[] = { 0, 2, 2, 3, 3, 3, 4 };
+
+	//the fields of the two matrices whose kinds share a tag byte
+	struct PairFields
+	{
+		unsigned char counts[256];
+		PairFields()
+		{
+			for (int tag = 0; tag < 256; tag++)
+				counts[tag] = (tag & 0xF) < 7 && (tag >> 4) < 7 ? static_cast<unsigned char>(fieldCounts[tag & 0xF] + fieldCounts[tag >> 4]) : 0;
+		}
+	};
+	const PairFields pairFields;
+
+	//the header kind of a block whose matrices have a kind each, in a nibble per matrix
+	const unsigned char mixedKinds = 7;
+	//the header bit of a block with XORed fields
+	const unsigned char xorBit = 0x80;
+
+	std::uint64_t bitsOf(double x)
+	{
+		std::uint64_t bits;
+		std::memcpy(&bits, &x, sizeof bits);
+		return bits;
+	}
+
+	double fromBits(std::uint64_t bits)
+	{
+		double x;
+		std::memcpy(&x, &bits, sizeof x);
+		return x;
+	}
+
+	const std::uint64_t positiveZero = bitsOf(0.0);
+	const std::uint64_t one = bitsOf(1.0);
+
+	//a field written without XOR, in the byte order of this machine since the collection only lives in memory
+	std::uint64_t plainField(const unsigned char* p)
+	{
+		std::uint64_t bits;
+		std::memcpy(&bits, p, sizeof bits);
+		return bits;
+	}
+
+	void writeField(std::vector<unsigned char>& out, std::uint64_t bits, std::uint64_t& previous, bool xorFields)
+	{
+		if (!xorFields)
+		{
+			const unsigned char* raw = reinterpret_cast<const unsigned char*>(&bits);
+			out.insert(out.end(), raw, raw + sizeof bits);
+			return;
+		}
+		const std::uint64_t x = bits ^ previous;
+		previous = bits;
+		if (x == 0)
+		{
+			out.push_back(0x80);
+			return;
+		}
+		int leading = 0, trailing = 0;
+		while ((x >> (56 - 8 * leading)) == 0)
+			leading++;
+		while (((x >> (8 * trailing)) & 0xFF) == 0)
+			trailing++;
+		out.push_back(static_cast<unsigned char>(leading << 4 | trailing));
+		for (int k = trailing; k < 8 - leading; k++)
+			out.push_back(static_cast<unsigned char>(x >> (8 * k)));
+	}
+
+	//a field written with XOR, see writeField()
+	const unsigned char* readXorField(const unsigned char* p, std::uint64_t& bits, std::uint64_t& previous)
+	{
+		const int leading = *p >> 4, trailing = *p & 0xF;
+		p++;
+		std::uint64_t x = 0;
+		for (int k = trailing; k < 8 - leading; k++)
+			x |= std::uint64_t(*p++) << (8 * k);
+		bits = previous ^ x;
+		previous = bits;
+		return p;
+	}
+
+	/*
+	* to encode one block
+
+	* @param  out - where the block is appended
+	* @param  m - pointer to the first matrix of the block
+	* @param  kinds - the kind each matrix is stored as
+	* @param  n - the number of matrices
+	* @param  mixed - true to write a kind per matrix, false to write kinds[0] once
+	* @param  xorFields - true to XOR-compress the fields
+	*/
+	void encodeBlock(std::vector<unsigned char>& out, const Mat2x2* m, const StoredKind* kinds, std::size_t n, bool mixed, bool xorFields)
+	{
+		out.push_back(static_cast<unsigned char>((mixed ? mixedKinds : static_cast<unsigned char>(kinds[0])) | (xorFields ? xorBit : 0)));
+		if (mixed)
+			for (std::size_t i = 0; i < n; i += 2)
+				out.push_back(static_cast<unsigned char>(static_cast<unsigned char>(kinds[i])
+					| (i + 1 < n ? static_cast<unsigned char>(kinds[i + 1]) << 4 : 0)));
+		std::uint64_t previous[4] = { 0, 0, 0, 0 };
+		for (std::size_t i = 0; i < n; i++)
+		{
+			const unsigned char fields = storedFields[static_cast<int>(kinds[i])];
+			for (int k = 0; k < 4; k++)
+				if (fields & (1 << k))
+					writeField(out, bitsOf(m[i][k]), previous[k], xorFields);
+		}
+	}
+
+	//the values of a kind rebuilt from its stored fields, the others +0
+	void rebuild(unsigned char kind, std::uint64_t* bits, double* o)
+	{
+		switch (static_cast<StoredKind>(kind))
+		{
+		case StoredKind::Identity:
+			bits[0] = bits[3] = one;
+			break;
+		case StoredKind::Rotation:
+			bits[1] = bitsOf(-fromBits(bits[2]));
+			bits[3] = bits[0];
+			break;
+		case StoredKind::Symmetric:
+			bits[2] = bits[1];
+			break;
+		default:
+			break;
+		}
+		std::memcpy(o, bits, 4 * sizeof(double));
+	}
+
+	/*
+	* to decode one matrix of plain fields, one branch on the kind rather
+		than one per field
+
+	* @return the fields of the next matrix
+	*/
+	const unsigned char* decodePlain(const unsigned char* p, unsigned char kind, double* o)
+	{
+		std::uint64_t bits[4] = { positiveZero, positiveZero, positiveZero, positiveZero };
+		switch (static_cast<StoredKind>(kind))
+		{
+		case StoredKind::Identity:
+			break;
+		case StoredKind::Diagonal:
+			bits[0] = plainField(p);
+			bits[3] = plainField(p + 8);
+			break;
+		case StoredKind::Rotation:
+			bits[0] = plainField(p);
+			bits[2] = plainField(p + 8);
+			break;
+		case StoredKind::Symmetric:
+		case StoredKind::UpperTriangular:
+			bits[0] = plainField(p);
+			bits[1] = plainField(p + 8);
+			bits[3] = plainField(p + 16);
+			break;
+		case StoredKind::LowerTriangular:
+			bits[0] = plainField(p);
+			bits[2] = plainField(p + 8);
+			bits[3] = plainField(p + 16);
+			break;
+		default:
+			for (int k = 0; k < 4; k++)
+				bits[k] = plainField(p + 8 * k);
+		}
+		rebuild(kind, bits, o);
+		return p + 8 * fieldCounts[kind];
+	}
+}
+
+/*
+* to find how a matrix can be stored without losing any bits
+
+* @param  m - a referrence to a 2x2 matrix
+
+* @return the most compact kind that rebuilds m exactly
+*/
+StoredKind storedKind(const Mat2x2& m)
+{
+	const std::uint64_t a = bitsOf(m[0]), b = bitsOf(m[1]), c = bitsOf(m[2]), d = bitsOf(m[3]);
+	if (b == positiveZero && c == positiveZero)
+		return a == one && d == one ? StoredKind::Identity : StoredKind::Diagonal;
+	if (a == d && b == bitsOf(-m[2]))
+		return StoredKind::Rotation;
+	if (b == c)
+		return StoredKind::Symmetric;
+	if (c == positiveZero)
+		return StoredKind::UpperTriangular;
+	if (b == positiveZero)
+		return StoredKind::LowerTriangular;
+	return StoredKind::General;
+}
+
+/*
+* constructor creates an empty collection
+
+* @param  xorFields - true to XOR-compress the stored values
+* @param  blockSize - the number of matrices per independently decodable block
+*/
+CompressedMatrices::CompressedMatrices(bool xorFields, std::size_t blockSize)
+	: xorFields{ xorFields }, blockSize{ blockSize }, count{ 0 }
+{
+	if (blockSize == 0)
+		throw std::invalid_argument("Invalid arguments");
+	this->open.reserve(blockSize);
+}
+
+/*
+* to append a matrix, the block is encoded once it is full
+
+* @param  m - a referrence to a 2x2 matrix
+*/
+void CompressedMatrices::push_back(const Mat2x2& m)
+{
+	this->open.push_back(m);
+	this->count++;
+	if (this->open.size() == this->blockSize)
+	{
+		this->seal();
+		this->open.clear();
+	}
+}
+
+/*
+* to encode the open block in whichever format is smallest: one kind
+	for the whole block or a kind per matrix, plain or XORed fields,
+	or raw General matrices when no kind saves anything
+*/
+void CompressedMatrices::seal()
+{
+	const std::size_t n = this->open.size();
+	std::vector<StoredKind> kinds(n), general(n, StoredKind::General);
+	bool mixed = false;
+	for (std::size_t i = 0; i < n; i++)
+	{
+		kinds[i] = storedKind(this->open[i]);
+		mixed = mixed || kinds[i] != kinds[0];
+	}
+	std::vector<unsigned char> best, candidate;
+	encodeBlock(best, this->open.data(), general.data(), n, false, false);
+	for (bool xorFields : { false, true })
+	{
+		if (xorFields && !this->xorFields)
+			break;
+		candidate.clear();
+		encodeBlock(candidate, this->open.data(), kinds.data(), n, mixed, xorFields);
+		if (candidate.size() < best.size())
+			best.swap(candidate);
+	}
+	this->blockOffsets.push_back(this->bytes.size());
+	this->bytes.insert(this->bytes.end(), best.begin(), best.end());
+}
+
+/*
+* to append matrices
+
+* @param  m - pointer to the first matrix
+* @param  n - the number of matrices
+*/
+void CompressedMatrices::append(const Mat2x2* m, std::size_t n)
+{
+	for (std::size_t i = 0; i < n; i++)
+		this->push_back(m[i]);
+}
+
+/*
+* @return the number of matrices
+*/
+std::size_t CompressedMatrices::size() const
+{
+	return this->count;
+}
+
+/*
+* @return the bytes of encoded matrices, block index and open block,
+	compare with size() * sizeof(Mat2x2)
+*/
+std::size_t CompressedMatrices::compressedBytes() const
+{
+	return this->bytes.size() + this->blockOffsets.size() * sizeof(std::size_t) + this->open.size() * sizeof(Mat2x2);
+}
+
+/*
+* to decode consecutive matrices of one encoded block. Plain blocks of
+	one kind are indexed directly, the others skip or decode the
+	matrices before the first one
+
+* @param  block - the index of the block
+* @param  first - the index of the first matrix in the block
+* @param  out - pointer to where the matrices are written
+* @param  n - the number of matrices
+*/
+void CompressedMatrices::decodeBlock(std::size_t block, std::size_t first, Mat2x2* out, std::size_t n) const
+{
+	const unsigned char* p = this->bytes.data() + this->blockOffsets[block];
+	const bool xored = (*p & xorBit) != 0;
+	const unsigned char header = *p++ & ~xorBit;
+	const unsigned char* tags = p;
+	std::size_t i = 0;
+	if (header == mixedKinds)
+		p += (this->blockSize + 1) / 2;
+	if (!xored)
+	{
+		//plain fields have a known length, step over the matrices before the first
+		std::size_t skipped = first * fieldCounts[header == mixedKinds ? 0 : header];
+		if (header == mixedKinds)
+		{
+			for (std::size_t j = 0; j < first / 2; j++)
+				skipped += pairFields.counts[tags[j]];
+			if (first % 2)
+				skipped += fieldCounts[tags[first / 2] & 0xF];
+		}
+		p += 8 * skipped;
+		i = first;
+	}
+	double* o = out->data();
+	std::uint64_t previous[4] = { 0, 0, 0, 0 };
+	for (; i < first + n; i++)
+	{
+		const unsigned char kind = header == mixedKinds ? (tags[i / 2] >> (4 * (i % 2))) & 0xF : header;
+		if (!xored)
+		{
+			p = decodePlain(p, kind, o + 4 * (i - first));
+			continue;
+		}
+		const unsigned char stored = storedFields[kind];
+		std::uint64_t bits[4] = { positiveZero, positiveZero, positiveZero, positiveZero };
+		for (int k = 0; k < 4; k++)
+			if (stored & (1 << k))
+				p = readXorField(p, bits[k], previous[k]);
+		if (i >= first)
+			rebuild(kind, bits, o + 4 * (i - first));
+	}
+}
+
+/*
+* operator overiding function for the [] operator, decodes the block
+	of the matrix up to it
+
+* @param  i - the index of the matrix
+
+* @return a copy of the matrix
+*/
+Mat2x2 CompressedMatrices::operator[](std::size_t i) const
+{
+	Mat2x2 result;
+	this->decode(i, &result, 1);
+	return result;
+}
+
+/*
+* to decode consecutive matrices
+
+* @param  first - the index of the first matrix
+* @param  out - pointer to where the matrices are written
+* @param  n - the number of matrices
+*/
+void CompressedMatrices::decode(std::size_t first, Mat2x2* out, std::size_t n) const
+{
+	if (first > this->count || n > this->count - first)
+		throw std::invalid_argument("index out of bound");
+	while (n > 0)
+	{
+		const std::size_t block = first / this->blockSize, offset = first % this->blockSize;
+		const std::size_t length = std::min(n, this->blockSize - offset);
+		if (block < this->blockOffsets.size())
+			this->decodeBlock(block, offset, out, length);
+		else
+			std::copy(this->open.begin() + offset, this->open.begin() + offset + length, out);
+		first += length;
+		out += length;
+		n -= length;
+	}
+}
+
+/*
+* to visit every matrix in order, one decoded block at a time
+
+* @param  visitor - called with each block, the pointer is valid only during the call
+*/
+void CompressedMatrices::scan(const BatchVisitor& visitor) const
+{
+	std::vector<Mat2x2> block(this->blockSize);
+	for (std::size_t b = 0; b < this->blockOffsets.size(); b++)
+	{
+		this->decodeBlock(b, 0, block.data(), this->blockSize);
+		visitor(block.data(), this->blockSize);
+	}
+	if (!this->open.empty())
+		visitor(this->open.data(), this->open.size());
+}
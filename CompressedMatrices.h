@@ -0,0 +1,93 @@
+#ifndef COMPRESSEDMATRICES_H
+#define COMPRESSEDMATRICES_H
+#include<cstddef>
+#include<cstdint>
+#include<functional>
+#include<vector>
+#include"Mat2x2.h"
+
+/*
+* the structure a matrix is stored with, only the values it cannot
+	rebuild exactly are kept
+
+	Identity			none
+	Diagonal			a, d		b = c = +0
+	Rotation			a, c		b = -c, d = a
+	Symmetric			a, b, d		c = b
+	UpperTriangular		a, b, d		c = +0
+	LowerTriangular		a, c, d		b = +0
+	General				a, b, c, d
+
+* kinds compare bit patterns, so -0 and NaN payloads survive a round trip
+*/
+enum class StoredKind : unsigned char
+{
+	Identity,
+	Diagonal,
+	Rotation,
+	Symmetric,
+	UpperTriangular,
+	LowerTriangular,
+	General
+};
+
+StoredKind storedKind(const Mat2x2&);
+
+/*
+* an append-only, lossless, compressed collection of matrices
+
+* matrices are grouped in blocks that decode independently. A block is
+	encoded when it fills, in whichever of these formats is smallest:
+	one kind for the whole block, or a kind per matrix in a nibble each;
+	the free values as raw doubles or, with xorFields, XORed with the
+	previous value of the same field and written without their zero
+	leading and trailing bytes behind one control byte. A block of
+	General matrices, or one no format shrinks, is stored raw, so no
+	block takes more than one header byte over four doubles a matrix.
+	The last, partial block is kept decoded until it fills.
+
+* random access is O(1) in plain blocks of one kind and O(blockSize)
+	in the others, which skip or decode the matrices before the one
+	asked for. scan() decodes one block at a time into a small buffer
+	to feed the batch kernels.
+
+* measured ratios, size() * sizeof(Mat2x2) / compressedBytes() with
+	blocks of 256 ("driver --bench compressed"):
+	70% identity, diagonal and symmetric, random values - 1.64x
+	the same sorted into runs of one kind - 1.69x
+	random General - 1.00x, plain or XOR
+	diagonals quantised to 1/1024 - 1.98x, 7.6x with XOR
+	Structure alone cannot reach 2x on random values; XOR gets there
+	when values repeat or share their high bytes. Scans decode 4 to 10
+	ns a matrix on one core, against 2 to 3 ns to stream a plain
+	vector, so they save memory rather than time.
+*/
+class CompressedMatrices
+{
+public:
+	typedef std::function<void(const Mat2x2*, std::size_t)> BatchVisitor;
+private:
+	bool xorFields;
+	std::size_t blockSize;
+	std::size_t count;
+	std::vector<unsigned char> bytes;
+	std::vector<std::size_t> blockOffsets;
+	std::vector<Mat2x2> open;
+	void seal();
+	void decodeBlock(std::size_t, std::size_t, Mat2x2*, std::size_t) const;
+public:
+	explicit CompressedMatrices(bool = false, std::size_t = 256);
+
+	void push_back(const Mat2x2&);
+	void append(const Mat2x2*, std::size_t);
+
+	std::size_t size() const;
+	std::size_t compressedBytes() const;
+
+	//Random access
+	Mat2x2 operator[](std::size_t) const;
+	void decode(std::size_t, Mat2x2*, std::size_t) const;
+
+	void scan(const BatchVisitor&) const;
+};
+#endif
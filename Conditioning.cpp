@@ -0,0 +1,160 @@
+#include "Conditioning.h"
+#include "ClosedForm.h"
+#include "CpuDispatch.h"
+#include<algorithm>
+#include<cfloat>
+#include<cmath>
+#include<limits>
+
+namespace
+{
+	static_assert(sizeof(Mat2x2) == 4 * sizeof(double), "Mat2x2 must be four packed doubles");
+
+	/*
+	* condition number at or above which a matrix is numerically singular,
+		the inverse would lose every significant digit
+	*/
+	const double singularCondition = 1 / DBL_EPSILON;
+
+	/*
+	* branch-free classification of one condition number, NaN counts as singular
+	*/
+	inline ConditionClass classOf(double condition, double maxCondition)
+	{
+		return condition < maxCondition ? ConditionClass::WellConditioned
+			: condition < singularCondition ? ConditionClass::IllConditioned
+			: ConditionClass::Singular;
+	}
+}
+
+/*
+* to find the Frobenius norm of the matrix
+	sqrt(a^2 + b^2 + c^2 + d^2)
+
+* @param  m - a referrence to a 2x2 matrix
+
+* @return a double value of the norm
+*/
+double normFrobenius(const Mat2x2& m)
+{
+	const double* v = m.data();
+	return std::hypot(std::hypot(v[0], v[1]), std::hypot(v[2], v[3]));
+}
+
+/*
+* to find the 1-norm of the matrix, the largest absolute column sum
+
+* @param  m - a referrence to a 2x2 matrix
+
+* @return a double value of the norm
+*/
+double norm1(const Mat2x2& m)
+{
+	const double* v = m.data();
+	return std::max(std::abs(v[0]) + std::abs(v[2]), std::abs(v[1]) + std::abs(v[3]));
+}
+
+/*
+* to find the infinity norm of the matrix, the largest absolute row sum
+
+* @param  m - a referrence to a 2x2 matrix
+
+* @return a double value of the norm
+*/
+double normInf(const Mat2x2& m)
+{
+	const double* v = m.data();
+	return std::max(std::abs(v[0]) + std::abs(v[1]), std::abs(v[2]) + std::abs(v[3]));
+}
+
+/*
+* to find the 2-norm of the matrix, its largest singular value,
+	in closed form from the rotation and reflection parts of the matrix
+
+* @param  m - a referrence to a 2x2 matrix
+
+* @return a double value of the norm
+*/
+double norm2(const Mat2x2& m)
+{
+	const double* v = m.data();
+	return (std::hypot(v[0] + v[3], v[2] - v[1]) + std::hypot(v[0] - v[3], v[2] + v[1])) / 2;
+}
+
+/*
+* to find the 2-norm condition number of the matrix, which unlike
+	the determinant does not change when the matrix is scaled
+
+* @param  m - a referrence to a 2x2 matrix
+
+* @return a double value of the condition number,
+	infinity if the matrix is singular
+*/
+double conditionNumber(const Mat2x2& m)
+{
+	const double* v = m.data();
+	double condition;
+	conditionClosedForm(v[0], v[1], v[2], v[3], condition);
+	if (std::isnan(condition))
+		return std::numeric_limits<double>::infinity();
+	return condition;
+}
+
+/*
+* to classify every matrix of a batch by its condition number, computed
+	by the vectorised kernels of the active instruction set level
+
+* @param  in - pointer to the first matrix
+* @param  classes - pointer to the first result
+* @param  n - the number of matrices
+* @param  maxCondition - the condition number below which a matrix is well conditioned
+*/
+void classifyConditioning(const Mat2x2* in, ConditionClass* classes, std::size_t n, double maxCondition)
+{
+	const std::size_t chunk = 256;
+	double conditions[chunk];
+	const BatchKernels& batch = kernels();
+	for (std::size_t begin = 0; begin < n; begin += chunk)
+	{
+		const std::size_t count = std::min(chunk, n - begin);
+		batch.conditionNumber(in + begin, conditions, count);
+		for (std::size_t i = 0; i < count; i++)
+			classes[begin + i] = classOf(conditions[i], maxCondition);
+	}
+}
+
+/*
+* to split a batch into well conditioned, ill conditioned and singular
+	matrices, so that inverse and solve kernels can run without checks
+	on the well conditioned set
+
+* @param  in - pointer to the first matrix
+* @param  n - the number of matrices
+* @param  maxCondition - the condition number below which a matrix is well conditioned
+* @param  resource - the memory resource the index vectors are allocated from
+
+* @return the indices of the matrices in each class, in increasing order
+*/
+ConditionPartition partitionByConditioning(const Mat2x2* in, std::size_t n, double maxCondition,
+	std::pmr::memory_resource* resource)
+{
+	const std::size_t chunk = 256;
+	ConditionClass classes[chunk];
+	ConditionPartition result(resource);
+	result.wellConditioned.reserve(n);
+	for (std::size_t begin = 0; begin < n; begin += chunk)
+	{
+		const std::size_t count = std::min(chunk, n - begin);
+		classifyConditioning(in + begin, classes, count, maxCondition);
+		for (std::size_t i = 0; i < count; i++)
+		{
+			if (classes[i] == ConditionClass::WellConditioned)
+				result.wellConditioned.push_back(begin + i);
+			else if (classes[i] == ConditionClass::IllConditioned)
+				result.illConditioned.push_back(begin + i);
+			else
+				result.singular.push_back(begin + i);
+		}
+	}
+	return result;
+}
@@ -0,0 +1,42 @@
+#ifndef CONDITIONING_H
+#define CONDITIONING_H
+#include<cstddef>
+#include<memory_resource>
+#include<vector>
+#include"Mat2x2.h"
+
+double normFrobenius(const Mat2x2&);
+double norm1(const Mat2x2&);
+double normInf(const Mat2x2&);
+double norm2(const Mat2x2&);
+
+//2-norm condition number, infinite for a singular matrix
+double conditionNumber(const Mat2x2&);
+
+enum class ConditionClass : unsigned char
+{
+	WellConditioned,
+	IllConditioned,
+	Singular
+};
+
+/*
+* indices into a batch, split by condition class
+*/
+struct ConditionPartition
+{
+	explicit ConditionPartition(std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+		: wellConditioned(resource), illConditioned(resource), singular(resource) {}
+
+	std::pmr::vector<std::size_t> wellConditioned;
+	std::pmr::vector<std::size_t> illConditioned;
+	std::pmr::vector<std::size_t> singular;
+};
+
+//condition number below which a matrix is well conditioned by default
+const double defaultMaxCondition = 1e8;
+
+void classifyConditioning(const Mat2x2*, ConditionClass*, std::size_t, double = defaultMaxCondition);
+ConditionPartition partitionByConditioning(const Mat2x2*, std::size_t, double = defaultMaxCondition,
+	std::pmr::memory_resource* = std::pmr::get_default_resource());
+#endif
@@ -0,0 +1,1518 @@
+#include "CpuDispatch.h"
+#include "MatrixGenerator.h"
+#include "Compensated.h"
+#include "ClosedForm.h"
+#include<algorithm>
+#include<cfloat>
+#include<cmath>
+#include<cstdlib>
+#include<limits>
+#include<stdexcept>
+#include<string>
+#include<vector>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define MAT2X2_X86
+#include<immintrin.h>
+#if defined(_MSC_VER)
+#include<intrin.h>
+//MSVC compiles every intrinsic without per-function flags
+#define MAT2X2_TARGET(isa)
+#define MAT2X2_FLATTEN
+#else
+#define MAT2X2_TARGET(isa) __attribute__((target(isa)))
+//inlines the lane operations of a kernel into it so they take its target
+#define MAT2X2_FLATTEN __attribute__((flatten))
+#endif
+#endif
+
+namespace
+{
+	static_assert(sizeof(Mat2x2) == 4 * sizeof(double), "Mat2x2 must be four packed doubles");
+	static_assert(sizeof(Eigenvalues) == 4 * sizeof(double), "Eigenvalues must be four packed doubles");
+
+	//Mat2x2::inverse() throws at or below this determinant
+	const double invertibleLimit = std::exp(-6);
+	const double nan = std::numeric_limits<double>::quiet_NaN();
+
+	const double* packed(const Mat2x2* m)
+	{
+		return m->data();
+	}
+
+	double* packed(Mat2x2* m)
+	{
+		return m->data();
+	}
+
+	//scalar kernels on one matrix, also used for the tails of the vector kernels
+
+	inline void multiplyOne(const double* l, const double* r, double* o)
+	{
+		const double a = l[0] * r[0] + l[1] * r[2];
+		const double b = l[0] * r[1] + l[1] * r[3];
+		const double c = l[2] * r[0] + l[3] * r[2];
+		const double d = l[2] * r[1] + l[3] * r[3];
+		o[0] = a;
+		o[1] = b;
+		o[2] = c;
+		o[3] = d;
+	}
+
+	inline std::size_t invertWith(const double* m, double det, double* o)
+	{
+		if (det == 0 || std::abs(det) <= invertibleLimit)
+		{
+			o[0] = o[1] = o[2] = o[3] = nan;
+			return 1;
+		}
+		const double r = 1 / det;
+		const double a = m[3] * r, b = -m[1] * r, c = -m[2] * r, d = m[0] * r;
+		o[0] = a;
+		o[1] = b;
+		o[2] = c;
+		o[3] = d;
+		return 0;
+	}
+
+	inline std::size_t inverseOne(const double* m, double* o)
+	{
+		return invertWith(m, m[0] * m[3] - m[1] * m[2], o);
+	}
+
+	inline void determinantTraceOne(const double* m, double* det, double* trace)
+	{
+		*det = m[0] * m[3] - m[1] * m[2];
+		*trace = m[0] + m[3];
+	}
+
+	//the expressions of eigenvalues() with the determinant the table's arithmetic computed
+	inline void eigenvaluesWith(const double* m, double det, Eigenvalues* o)
+	{
+		const double t = m[0] + m[3];
+		const double z = t * t - 4 * det;
+		const double root = std::sqrt(std::abs(z)) / 2;
+		const bool real = z >= 0;
+		o->re1 = real ? t / 2 + root : t / 2;
+		o->re2 = real ? t / 2 - root : t / 2;
+		o->im1 = real ? 0 : root;
+		o->im2 = real ? 0 : -root;
+	}
+
+	void addScalar(const Mat2x2* lhs, const Mat2x2* rhs, Mat2x2* out, std::size_t n)
+	{
+		for (std::size_t k = 0; k < 4 * n; k++)
+			packed(out)[k] = packed(lhs)[k] + packed(rhs)[k];
+	}
+
+	void subtractScalar(const Mat2x2* lhs, const Mat2x2* rhs, Mat2x2* out, std::size_t n)
+	{
+		for (std::size_t k = 0; k < 4 * n; k++)
+			packed(out)[k] = packed(lhs)[k] - packed(rhs)[k];
+	}
+
+	void multiplyScalar(const Mat2x2* lhs, const Mat2x2* rhs, Mat2x2* out, std::size_t n)
+	{
+		for (std::size_t i = 0; i < n; i++)
+			multiplyOne(packed(lhs) + 4 * i, packed(rhs) + 4 * i, packed(out) + 4 * i);
+	}
+
+	std::size_t inverseScalar(const Mat2x2* in, Mat2x2* out, std::size_t n)
+	{
+		std::size_t failed = 0;
+		for (std::size_t i = 0; i < n; i++)
+			failed += inverseOne(packed(in) + 4 * i, packed(out) + 4 * i);
+		return failed;
+	}
+
+	void determinantTraceScalar(const Mat2x2* in, double* det, double* trace, std::size_t n)
+	{
+		for (std::size_t i = 0; i < n; i++)
+			determinantTraceOne(packed(in) + 4 * i, det + i, trace + i);
+	}
+
+	void eigenvaluesScalar(const Mat2x2* in, Eigenvalues* out, std::size_t n)
+	{
+		const double* m = packed(in);
+		for (std::size_t i = 0; i < n; i++, m += 4)
+			eigenvaluesWith(m, m[0] * m[3] - m[1] * m[2], out + i);
+	}
+
+	//the same kernels with Kahan's compensated products, see Compensated.h
+
+	inline void multiplyCompensatedOne(const double* l, const double* r, double* o)
+	{
+		const double a = compensatedDot(l[0], r[0], l[1], r[2]);
+		const double b = compensatedDot(l[0], r[1], l[1], r[3]);
+		const double c = compensatedDot(l[2], r[0], l[3], r[2]);
+		const double d = compensatedDot(l[2], r[1], l[3], r[3]);
+		o[0] = a;
+		o[1] = b;
+		o[2] = c;
+		o[3] = d;
+	}
+
+	inline double compensatedDeterminant(const double* m)
+	{
+		return compensatedDot(m[0], m[3], -m[1], m[2]);
+	}
+
+	void multiplyCompensatedScalar(const Mat2x2* lhs, const Mat2x2* rhs, Mat2x2* out, std::size_t n)
+	{
+		for (std::size_t i = 0; i < n; i++)
+			multiplyCompensatedOne(packed(lhs) + 4 * i, packed(rhs) + 4 * i, packed(out) + 4 * i);
+	}
+
+	std::size_t inverseCompensatedScalar(const Mat2x2* in, Mat2x2* out, std::size_t n)
+	{
+		std::size_t failed = 0;
+		for (std::size_t i = 0; i < n; i++)
+			failed += invertWith(packed(in) + 4 * i, compensatedDeterminant(packed(in) + 4 * i), packed(out) + 4 * i);
+		return failed;
+	}
+
+	void determinantTraceCompensatedScalar(const Mat2x2* in, double* det, double* trace, std::size_t n)
+	{
+		for (std::size_t i = 0; i < n; i++)
+		{
+			det[i] = compensatedDeterminant(packed(in) + 4 * i);
+			trace[i] = packed(in)[4 * i] + packed(in)[4 * i + 3];
+		}
+	}
+
+	void eigenvaluesCompensatedScalar(const Mat2x2* in, Eigenvalues* out, std::size_t n)
+	{
+		const double* m = packed(in);
+		for (std::size_t i = 0; i < n; i++, m += 4)
+			eigenvaluesWith(m, compensatedDeterminant(m), out + i);
+	}
+
+	//the decompositions one matrix at a time, see ClosedForm.h
+
+	void svdScalar(const Mat2x2* in, SingularValueDecomposition* out, std::size_t n)
+	{
+		for (std::size_t i = 0; i < n; i++)
+			out[i] = svd(in[i]);
+	}
+
+	void polarScalar(const Mat2x2* in, PolarDecomposition* out, std::size_t n)
+	{
+		for (std::size_t i = 0; i < n; i++)
+			out[i] = polar(in[i]);
+	}
+
+	void qrScalar(const Mat2x2* in, QRDecomposition* out, std::size_t n)
+	{
+		for (std::size_t i = 0; i < n; i++)
+			out[i] = qr(in[i]);
+	}
+
+	void symmetricEigenScalar(const Mat2x2* in, EigenDecomposition* out, std::size_t n)
+	{
+		double o[6];
+		for (std::size_t i = 0; i < n; i++)
+		{
+			symmetricEigenClosedForm(in[i][0], in[i][1], in[i][3], o);
+			out[i].lambda1 = o[0];
+			out[i].lambda2 = o[1];
+			out[i].vectors = Mat2x2(o[2], o[3], o[4], o[5]);
+		}
+	}
+
+	void conditionNumberScalar(const Mat2x2* in, double* out, std::size_t n)
+	{
+		const double* m = packed(in);
+		for (std::size_t i = 0; i < n; i++, m += 4)
+			conditionClosedForm(m[0], m[1], m[2], m[3], out[i]);
+	}
+
+	/*
+	* the closed forms on V::width matrices at a time, V is one of the lane
+		types below; the last n % V::width matrices go one at a time
+	*/
+	template<typename V>
+	inline void svdLanes(const Mat2x2* in, SingularValueDecomposition* out, std::size_t n)
+	{
+		std::size_t i = 0;
+		for (; i + V::width <= n; i += V::width)
+		{
+			V a, b, c, d, o[10];
+			double r[10][V::width];
+			loadLanes(packed(in) + 4 * i, a, b, c, d);
+			svdClosedForm(a, b, c, d, o);
+			for (int j = 0; j < 10; j++)
+				storeLanes(r[j], o[j]);
+			for (std::size_t k = 0; k < V::width; k++)
+			{
+				double* u = packed(&out[i + k].u);
+				double* v = packed(&out[i + k].v);
+				for (int j = 0; j < 4; j++)
+				{
+					u[j] = r[j][k];
+					v[j] = r[6 + j][k];
+				}
+				out[i + k].sigma1 = r[4][k];
+				out[i + k].sigma2 = r[5][k];
+			}
+		}
+		svdScalar(in + i, out + i, n - i);
+	}
+
+	template<typename V>
+	inline void polarLanes(const Mat2x2* in, PolarDecomposition* out, std::size_t n)
+	{
+		std::size_t i = 0;
+		for (; i + V::width <= n; i += V::width)
+		{
+			V a, b, c, d, o[8];
+			double r[8][V::width];
+			loadLanes(packed(in) + 4 * i, a, b, c, d);
+			polarClosedForm(a, b, c, d, o);
+			for (int j = 0; j < 8; j++)
+				storeLanes(r[j], o[j]);
+			for (std::size_t k = 0; k < V::width; k++)
+			{
+				double* rotation = packed(&out[i + k].r);
+				double* stretch = packed(&out[i + k].s);
+				for (int j = 0; j < 4; j++)
+				{
+					rotation[j] = r[j][k];
+					stretch[j] = r[4 + j][k];
+				}
+			}
+		}
+		polarScalar(in + i, out + i, n - i);
+	}
+
+	template<typename V>
+	inline void qrLanes(const Mat2x2* in, QRDecomposition* out, std::size_t n)
+	{
+		std::size_t i = 0;
+		for (; i + V::width <= n; i += V::width)
+		{
+			V a, b, c, d, o[8];
+			double r[8][V::width];
+			loadLanes(packed(in) + 4 * i, a, b, c, d);
+			qrClosedForm(a, b, c, d, o);
+			for (int j = 0; j < 8; j++)
+				storeLanes(r[j], o[j]);
+			for (std::size_t k = 0; k < V::width; k++)
+			{
+				double* q = packed(&out[i + k].q);
+				double* triangle = packed(&out[i + k].r);
+				for (int j = 0; j < 4; j++)
+				{
+					q[j] = r[j][k];
+					triangle[j] = r[4 + j][k];
+				}
+			}
+		}
+		qrScalar(in + i, out + i, n - i);
+	}
+
+	template<typename V>
+	inline void symmetricEigenLanes(const Mat2x2* in, EigenDecomposition* out, std::size_t n)
+	{
+		std::size_t i = 0;
+		for (; i + V::width <= n; i += V::width)
+		{
+			V a, b, c, d, o[6];
+			double r[6][V::width];
+			loadLanes(packed(in) + 4 * i, a, b, c, d);
+			symmetricEigenClosedForm(a, b, d, o);
+			for (int j = 0; j < 6; j++)
+				storeLanes(r[j], o[j]);
+			for (std::size_t k = 0; k < V::width; k++)
+			{
+				double* vectors = packed(&out[i + k].vectors);
+				for (int j = 0; j < 4; j++)
+					vectors[j] = r[2 + j][k];
+				out[i + k].lambda1 = r[0][k];
+				out[i + k].lambda2 = r[1][k];
+			}
+		}
+		symmetricEigenScalar(in + i, out + i, n - i);
+	}
+
+	template<typename V>
+	inline void conditionNumberLanes(const Mat2x2* in, double* out, std::size_t n)
+	{
+		std::size_t i = 0;
+		for (; i + V::width <= n; i += V::width)
+		{
+			V a, b, c, d, condition;
+			loadLanes(packed(in) + 4 * i, a, b, c, d);
+			conditionClosedForm(a, b, c, d, condition);
+			storeLanes(out + i, condition);
+		}
+		conditionNumberScalar(in + i, out + i, n - i);
+	}
+
+	const BatchKernels scalarKernels = { IsaLevel::Scalar, Arithmetic::Naive, addScalar, subtractScalar, multiplyScalar, inverseScalar, determinantTraceScalar, eigenvaluesScalar,
+		svdScalar, polarScalar, qrScalar, symmetricEigenScalar, conditionNumberScalar };
+	const BatchKernels scalarCompensatedKernels = { IsaLevel::Scalar, Arithmetic::Compensated, addScalar, subtractScalar,
+		multiplyCompensatedScalar, inverseCompensatedScalar, determinantTraceCompensatedScalar, eigenvaluesCompensatedScalar,
+		svdScalar, polarScalar, qrScalar, symmetricEigenScalar, conditionNumberScalar };
+
+#ifdef MAT2X2_X86
+	/*
+	* SSE2, two matrices per iteration. The element-wise kernels load two
+		matrices, transpose them so each register holds one value (a, b,
+		c or d) of both, compute, and transpose back.
+	*/
+	MAT2X2_TARGET("sse2") inline void load2(const double* p, __m128d& a, __m128d& b, __m128d& c, __m128d& d)
+	{
+		const __m128d ab0 = _mm_loadu_pd(p), cd0 = _mm_loadu_pd(p + 2);
+		const __m128d ab1 = _mm_loadu_pd(p + 4), cd1 = _mm_loadu_pd(p + 6);
+		a = _mm_unpacklo_pd(ab0, ab1);
+		b = _mm_unpackhi_pd(ab0, ab1);
+		c = _mm_unpacklo_pd(cd0, cd1);
+		d = _mm_unpackhi_pd(cd0, cd1);
+	}
+
+	MAT2X2_TARGET("sse2") inline void store2(double* p, __m128d a, __m128d b, __m128d c, __m128d d)
+	{
+		_mm_storeu_pd(p, _mm_unpacklo_pd(a, b));
+		_mm_storeu_pd(p + 2, _mm_unpacklo_pd(c, d));
+		_mm_storeu_pd(p + 4, _mm_unpackhi_pd(a, b));
+		_mm_storeu_pd(p + 6, _mm_unpackhi_pd(c, d));
+	}
+
+	MAT2X2_TARGET("sse2") inline __m128d select2(__m128d mask, __m128d x, __m128d y)
+	{
+		return _mm_or_pd(_mm_and_pd(mask, x), _mm_andnot_pd(mask, y));
+	}
+
+	MAT2X2_TARGET("sse2") void addSSE2(const Mat2x2* lhs, const Mat2x2* rhs, Mat2x2* out, std::size_t n)
+	{
+		for (std::size_t k = 0; k < 4 * n; k += 2)
+			_mm_storeu_pd(packed(out) + k, _mm_add_pd(_mm_loadu_pd(packed(lhs) + k), _mm_loadu_pd(packed(rhs) + k)));
+	}
+
+	MAT2X2_TARGET("sse2") void subtractSSE2(const Mat2x2* lhs, const Mat2x2* rhs, Mat2x2* out, std::size_t n)
+	{
+		for (std::size_t k = 0; k < 4 * n; k += 2)
+			_mm_storeu_pd(packed(out) + k, _mm_sub_pd(_mm_loadu_pd(packed(lhs) + k), _mm_loadu_pd(packed(rhs) + k)));
+	}
+
+	MAT2X2_TARGET("sse2") void multiplySSE2(const Mat2x2* lhs, const Mat2x2* rhs, Mat2x2* out, std::size_t n)
+	{
+		const double* l = packed(lhs);
+		const double* r = packed(rhs);
+		double* o = packed(out);
+		for (std::size_t i = 0; i < n; i++, l += 4, r += 4, o += 4)
+		{
+			const __m128d l0 = _mm_loadu_pd(l), l1 = _mm_loadu_pd(l + 2);
+			const __m128d r0 = _mm_loadu_pd(r), r1 = _mm_loadu_pd(r + 2);
+			//row i of the product is l[i][0] * row 0 of r + l[i][1] * row 1 of r
+			const __m128d o0 = _mm_add_pd(_mm_mul_pd(_mm_unpacklo_pd(l0, l0), r0), _mm_mul_pd(_mm_unpackhi_pd(l0, l0), r1));
+			const __m128d o1 = _mm_add_pd(_mm_mul_pd(_mm_unpacklo_pd(l1, l1), r0), _mm_mul_pd(_mm_unpackhi_pd(l1, l1), r1));
+			_mm_storeu_pd(o, o0);
+			_mm_storeu_pd(o + 2, o1);
+		}
+	}
+
+	MAT2X2_TARGET("sse2") std::size_t inverseSSE2(const Mat2x2* in, Mat2x2* out, std::size_t n)
+	{
+		const __m128d sign = _mm_set1_pd(-0.0), zero = _mm_setzero_pd();
+		const __m128d one = _mm_set1_pd(1.0), limit = _mm_set1_pd(invertibleLimit), nans = _mm_set1_pd(nan);
+		std::size_t failed = 0, i = 0;
+		for (; i + 2 <= n; i += 2)
+		{
+			__m128d a, b, c, d;
+			load2(packed(in) + 4 * i, a, b, c, d);
+			const __m128d det = _mm_sub_pd(_mm_mul_pd(a, d), _mm_mul_pd(b, c));
+			const __m128d bad = _mm_or_pd(_mm_cmpeq_pd(det, zero), _mm_cmple_pd(_mm_andnot_pd(sign, det), limit));
+			const __m128d r = _mm_div_pd(one, det);
+			store2(packed(out) + 4 * i,
+				select2(bad, nans, _mm_mul_pd(d, r)),
+				select2(bad, nans, _mm_mul_pd(_mm_xor_pd(b, sign), r)),
+				select2(bad, nans, _mm_mul_pd(_mm_xor_pd(c, sign), r)),
+				select2(bad, nans, _mm_mul_pd(a, r)));
+			const int mask = _mm_movemask_pd(bad);
+			failed += (mask & 1) + (mask >> 1);
+		}
+		for (; i < n; i++)
+			failed += inverseOne(packed(in) + 4 * i, packed(out) + 4 * i);
+		return failed;
+	}
+
+	MAT2X2_TARGET("sse2") void determinantTraceSSE2(const Mat2x2* in, double* det, double* trace, std::size_t n)
+	{
+		std::size_t i = 0;
+		for (; i + 2 <= n; i += 2)
+		{
+			__m128d a, b, c, d;
+			load2(packed(in) + 4 * i, a, b, c, d);
+			_mm_storeu_pd(det + i, _mm_sub_pd(_mm_mul_pd(a, d), _mm_mul_pd(b, c)));
+			_mm_storeu_pd(trace + i, _mm_add_pd(a, d));
+		}
+		for (; i < n; i++)
+			determinantTraceOne(packed(in) + 4 * i, det + i, trace + i);
+	}
+
+	//eigenvalues() of two matrices from their traces and determinants
+	MAT2X2_TARGET("sse2") inline void storeEigenvalues2(double* p, __m128d t, __m128d det)
+	{
+		const __m128d sign = _mm_set1_pd(-0.0), zero = _mm_setzero_pd();
+		const __m128d half = _mm_set1_pd(0.5), four = _mm_set1_pd(4.0);
+		const __m128d z = _mm_sub_pd(_mm_mul_pd(t, t), _mm_mul_pd(four, det));
+		const __m128d root = _mm_mul_pd(_mm_sqrt_pd(_mm_andnot_pd(sign, z)), half);
+		const __m128d mid = _mm_mul_pd(t, half);
+		const __m128d real = _mm_cmpge_pd(z, zero);
+		store2(p,
+			select2(real, _mm_add_pd(mid, root), mid),
+			_mm_andnot_pd(real, root),
+			select2(real, _mm_sub_pd(mid, root), mid),
+			_mm_andnot_pd(real, _mm_xor_pd(root, sign)));
+	}
+
+	MAT2X2_TARGET("sse2") void eigenvaluesSSE2(const Mat2x2* in, Eigenvalues* out, std::size_t n)
+	{
+		std::size_t i = 0;
+		for (; i + 2 <= n; i += 2)
+		{
+			__m128d a, b, c, d;
+			load2(packed(in) + 4 * i, a, b, c, d);
+			storeEigenvalues2(reinterpret_cast<double*>(out + i), _mm_add_pd(a, d), _mm_sub_pd(_mm_mul_pd(a, d), _mm_mul_pd(b, c)));
+		}
+		eigenvaluesScalar(in + i, out + i, n - i);
+	}
+
+	/*
+	* the lane types of the closed forms in ClosedForm.h: one register of
+		two, four or eight doubles, with each operation the instruction of
+		the scalar expression, max and min included
+	*/
+	struct Lanes2
+	{
+		static const std::size_t width = 2;
+		__m128d v;
+		Lanes2() {}
+		MAT2X2_TARGET("sse2") Lanes2(__m128d x) : v(x) {}
+		MAT2X2_TARGET("sse2") explicit Lanes2(double x) : v(_mm_set1_pd(x)) {}
+	};
+
+	struct Mask2
+	{
+		__m128d v;
+	};
+
+	MAT2X2_TARGET("sse2") inline Lanes2 operator+(Lanes2 x, Lanes2 y) { return _mm_add_pd(x.v, y.v); }
+	MAT2X2_TARGET("sse2") inline Lanes2 operator-(Lanes2 x, Lanes2 y) { return _mm_sub_pd(x.v, y.v); }
+	MAT2X2_TARGET("sse2") inline Lanes2 operator*(Lanes2 x, Lanes2 y) { return _mm_mul_pd(x.v, y.v); }
+	MAT2X2_TARGET("sse2") inline Lanes2 operator/(Lanes2 x, Lanes2 y) { return _mm_div_pd(x.v, y.v); }
+	MAT2X2_TARGET("sse2") inline Lanes2 operator-(Lanes2 x) { return _mm_xor_pd(x.v, _mm_set1_pd(-0.0)); }
+	MAT2X2_TARGET("sse2") inline Lanes2 sqrtOf(Lanes2 x) { return _mm_sqrt_pd(x.v); }
+	MAT2X2_TARGET("sse2") inline Lanes2 absOf(Lanes2 x) { return _mm_andnot_pd(_mm_set1_pd(-0.0), x.v); }
+	MAT2X2_TARGET("sse2") inline Lanes2 maxOf(Lanes2 x, Lanes2 y) { return _mm_max_pd(x.v, y.v); }
+	MAT2X2_TARGET("sse2") inline Lanes2 minOf(Lanes2 x, Lanes2 y) { return _mm_min_pd(x.v, y.v); }
+	MAT2X2_TARGET("sse2") inline Mask2 isEqual(Lanes2 x, Lanes2 y) { return { _mm_cmpeq_pd(x.v, y.v) }; }
+	MAT2X2_TARGET("sse2") inline Mask2 isLess(Lanes2 x, Lanes2 y) { return { _mm_cmplt_pd(x.v, y.v) }; }
+	MAT2X2_TARGET("sse2") inline Mask2 isGreaterEqual(Lanes2 x, Lanes2 y) { return { _mm_cmpge_pd(x.v, y.v) }; }
+	MAT2X2_TARGET("sse2") inline Lanes2 select(Mask2 mask, Lanes2 x, Lanes2 y) { return select2(mask.v, x.v, y.v); }
+
+	MAT2X2_TARGET("sse2") inline Lanes2 powerOfTwoScale(Lanes2 largest)
+	{
+		const __m128d clamped = _mm_min_pd(_mm_max_pd(largest.v, _mm_set1_pd(DBL_MIN)), _mm_set1_pd(DBL_MAX / 2));
+		const __m128i bits = _mm_and_si128(_mm_castpd_si128(clamped), _mm_set1_epi64x(exponentBits));
+		return _mm_castsi128_pd(_mm_sub_epi64(_mm_set1_epi64x(scaleBitsOffset), bits));
+	}
+
+	MAT2X2_TARGET("sse2") inline void loadLanes(const double* p, Lanes2& a, Lanes2& b, Lanes2& c, Lanes2& d)
+	{
+		load2(p, a.v, b.v, c.v, d.v);
+	}
+
+	MAT2X2_TARGET("sse2") inline void storeLanes(double* p, Lanes2 x)
+	{
+		_mm_storeu_pd(p, x.v);
+	}
+
+	MAT2X2_TARGET("sse2") MAT2X2_FLATTEN void svdSSE2(const Mat2x2* in, SingularValueDecomposition* out, std::size_t n)
+	{
+		svdLanes<Lanes2>(in, out, n);
+	}
+
+	MAT2X2_TARGET("sse2") MAT2X2_FLATTEN void polarSSE2(const Mat2x2* in, PolarDecomposition* out, std::size_t n)
+	{
+		polarLanes<Lanes2>(in, out, n);
+	}
+
+	MAT2X2_TARGET("sse2") MAT2X2_FLATTEN void qrSSE2(const Mat2x2* in, QRDecomposition* out, std::size_t n)
+	{
+		qrLanes<Lanes2>(in, out, n);
+	}
+
+	MAT2X2_TARGET("sse2") MAT2X2_FLATTEN void symmetricEigenSSE2(const Mat2x2* in, EigenDecomposition* out, std::size_t n)
+	{
+		symmetricEigenLanes<Lanes2>(in, out, n);
+	}
+
+	MAT2X2_TARGET("sse2") MAT2X2_FLATTEN void conditionNumberSSE2(const Mat2x2* in, double* out, std::size_t n)
+	{
+		conditionNumberLanes<Lanes2>(in, out, n);
+	}
+
+	const BatchKernels sse2Kernels = { IsaLevel::SSE2, Arithmetic::Naive, addSSE2, subtractSSE2, multiplySSE2, inverseSSE2, determinantTraceSSE2, eigenvaluesSSE2,
+		svdSSE2, polarSSE2, qrSSE2, symmetricEigenSSE2, conditionNumberSSE2 };
+	//SSE2 has no fused multiply-add, so the compensated products stay scalar
+	const BatchKernels sse2CompensatedKernels = { IsaLevel::SSE2, Arithmetic::Compensated, addSSE2, subtractSSE2,
+		multiplyCompensatedScalar, inverseCompensatedScalar, determinantTraceCompensatedScalar, eigenvaluesCompensatedScalar,
+		svdSSE2, polarSSE2, qrSSE2, symmetricEigenSSE2, conditionNumberSSE2 };
+
+	/*
+	* AVX2, one matrix per register for products and four matrices per
+		iteration, transposed 4x4, for the element-wise kernels
+	*/
+	MAT2X2_TARGET("avx2") inline void load4(const double* p, __m256d& a, __m256d& b, __m256d& c, __m256d& d)
+	{
+		const __m256d m0 = _mm256_loadu_pd(p), m1 = _mm256_loadu_pd(p + 4);
+		const __m256d m2 = _mm256_loadu_pd(p + 8), m3 = _mm256_loadu_pd(p + 12);
+		const __m256d ac01 = _mm256_unpacklo_pd(m0, m1), bd01 = _mm256_unpackhi_pd(m0, m1);
+		const __m256d ac23 = _mm256_unpacklo_pd(m2, m3), bd23 = _mm256_unpackhi_pd(m2, m3);
+		a = _mm256_permute2f128_pd(ac01, ac23, 0x20);
+		c = _mm256_permute2f128_pd(ac01, ac23, 0x31);
+		b = _mm256_permute2f128_pd(bd01, bd23, 0x20);
+		d = _mm256_permute2f128_pd(bd01, bd23, 0x31);
+	}
+
+	MAT2X2_TARGET("avx2") inline void store4(double* p, __m256d a, __m256d b, __m256d c, __m256d d)
+	{
+		const __m256d ab02 = _mm256_unpacklo_pd(a, b), ab13 = _mm256_unpackhi_pd(a, b);
+		const __m256d cd02 = _mm256_unpacklo_pd(c, d), cd13 = _mm256_unpackhi_pd(c, d);
+		_mm256_storeu_pd(p, _mm256_permute2f128_pd(ab02, cd02, 0x20));
+		_mm256_storeu_pd(p + 4, _mm256_permute2f128_pd(ab13, cd13, 0x20));
+		_mm256_storeu_pd(p + 8, _mm256_permute2f128_pd(ab02, cd02, 0x31));
+		_mm256_storeu_pd(p + 12, _mm256_permute2f128_pd(ab13, cd13, 0x31));
+	}
+
+	MAT2X2_TARGET("avx2") void addAVX2(const Mat2x2* lhs, const Mat2x2* rhs, Mat2x2* out, std::size_t n)
+	{
+		for (std::size_t k = 0; k < 4 * n; k += 4)
+			_mm256_storeu_pd(packed(out) + k, _mm256_add_pd(_mm256_loadu_pd(packed(lhs) + k), _mm256_loadu_pd(packed(rhs) + k)));
+	}
+
+	MAT2X2_TARGET("avx2") void subtractAVX2(const Mat2x2* lhs, const Mat2x2* rhs, Mat2x2* out, std::size_t n)
+	{
+		for (std::size_t k = 0; k < 4 * n; k += 4)
+			_mm256_storeu_pd(packed(out) + k, _mm256_sub_pd(_mm256_loadu_pd(packed(lhs) + k), _mm256_loadu_pd(packed(rhs) + k)));
+	}
+
+	MAT2X2_TARGET("avx2") void multiplyAVX2(const Mat2x2* lhs, const Mat2x2* rhs, Mat2x2* out, std::size_t n)
+	{
+		const double* l = packed(lhs);
+		const double* r = packed(rhs);
+		double* o = packed(out);
+		for (std::size_t i = 0; i < n; i++, l += 4, r += 4, o += 4)
+		{
+			const __m256d lm = _mm256_loadu_pd(l), rm = _mm256_loadu_pd(r);
+			//(a a c c) * (a' b' a' b') + (b b d d) * (c' d' c' d')
+			const __m256d product = _mm256_add_pd(
+				_mm256_mul_pd(_mm256_permute_pd(lm, 0x0), _mm256_permute2f128_pd(rm, rm, 0x00)),
+				_mm256_mul_pd(_mm256_permute_pd(lm, 0xF), _mm256_permute2f128_pd(rm, rm, 0x11)));
+			_mm256_storeu_pd(o, product);
+		}
+	}
+
+	MAT2X2_TARGET("avx2") std::size_t inverseAVX2(const Mat2x2* in, Mat2x2* out, std::size_t n)
+	{
+		const __m256d sign = _mm256_set1_pd(-0.0), zero = _mm256_setzero_pd();
+		const __m256d one = _mm256_set1_pd(1.0), limit = _mm256_set1_pd(invertibleLimit), nans = _mm256_set1_pd(nan);
+		std::size_t failed = 0, i = 0;
+		for (; i + 4 <= n; i += 4)
+		{
+			__m256d a, b, c, d;
+			load4(packed(in) + 4 * i, a, b, c, d);
+			const __m256d det = _mm256_sub_pd(_mm256_mul_pd(a, d), _mm256_mul_pd(b, c));
+			const __m256d bad = _mm256_or_pd(_mm256_cmp_pd(det, zero, _CMP_EQ_OQ),
+				_mm256_cmp_pd(_mm256_andnot_pd(sign, det), limit, _CMP_LE_OQ));
+			const __m256d r = _mm256_div_pd(one, det);
+			store4(packed(out) + 4 * i,
+				_mm256_blendv_pd(_mm256_mul_pd(d, r), nans, bad),
+				_mm256_blendv_pd(_mm256_mul_pd(_mm256_xor_pd(b, sign), r), nans, bad),
+				_mm256_blendv_pd(_mm256_mul_pd(_mm256_xor_pd(c, sign), r), nans, bad),
+				_mm256_blendv_pd(_mm256_mul_pd(a, r), nans, bad));
+			const int mask = _mm256_movemask_pd(bad);
+			failed += (mask & 1) + ((mask >> 1) & 1) + ((mask >> 2) & 1) + (mask >> 3);
+		}
+		for (; i < n; i++)
+			failed += inverseOne(packed(in) + 4 * i, packed(out) + 4 * i);
+		return failed;
+	}
+
+	MAT2X2_TARGET("avx2") void determinantTraceAVX2(const Mat2x2* in, double* det, double* trace, std::size_t n)
+	{
+		std::size_t i = 0;
+		for (; i + 4 <= n; i += 4)
+		{
+			__m256d a, b, c, d;
+			load4(packed(in) + 4 * i, a, b, c, d);
+			_mm256_storeu_pd(det + i, _mm256_sub_pd(_mm256_mul_pd(a, d), _mm256_mul_pd(b, c)));
+			_mm256_storeu_pd(trace + i, _mm256_add_pd(a, d));
+		}
+		for (; i < n; i++)
+			determinantTraceOne(packed(in) + 4 * i, det + i, trace + i);
+	}
+
+	//eigenvalues() of four matrices from their traces and determinants
+	MAT2X2_TARGET("avx2") inline void storeEigenvalues4(double* p, __m256d t, __m256d det)
+	{
+		const __m256d sign = _mm256_set1_pd(-0.0), zero = _mm256_setzero_pd();
+		const __m256d half = _mm256_set1_pd(0.5), four = _mm256_set1_pd(4.0);
+		const __m256d z = _mm256_sub_pd(_mm256_mul_pd(t, t), _mm256_mul_pd(four, det));
+		const __m256d root = _mm256_mul_pd(_mm256_sqrt_pd(_mm256_andnot_pd(sign, z)), half);
+		const __m256d mid = _mm256_mul_pd(t, half);
+		const __m256d real = _mm256_cmp_pd(z, zero, _CMP_GE_OQ);
+		store4(p,
+			_mm256_blendv_pd(mid, _mm256_add_pd(mid, root), real),
+			_mm256_andnot_pd(real, root),
+			_mm256_blendv_pd(mid, _mm256_sub_pd(mid, root), real),
+			_mm256_andnot_pd(real, _mm256_xor_pd(root, sign)));
+	}
+
+	MAT2X2_TARGET("avx2") void eigenvaluesAVX2(const Mat2x2* in, Eigenvalues* out, std::size_t n)
+	{
+		std::size_t i = 0;
+		for (; i + 4 <= n; i += 4)
+		{
+			__m256d a, b, c, d;
+			load4(packed(in) + 4 * i, a, b, c, d);
+			storeEigenvalues4(reinterpret_cast<double*>(out + i), _mm256_add_pd(a, d), _mm256_sub_pd(_mm256_mul_pd(a, d), _mm256_mul_pd(b, c)));
+		}
+		eigenvaluesScalar(in + i, out + i, n - i);
+	}
+
+	/*
+	* compensated AVX2 kernels, every AVX2 CPU also has FMA3. They
+		perform the same operations as compensatedDot(), lane by lane,
+		so they give the same bits as the scalar compensated kernels.
+	*/
+	MAT2X2_TARGET("avx2,fma") void multiplyCompensatedAVX2(const Mat2x2* lhs, const Mat2x2* rhs, Mat2x2* out, std::size_t n)
+	{
+		const double* l = packed(lhs);
+		const double* r = packed(rhs);
+		double* o = packed(out);
+		for (std::size_t i = 0; i < n; i++, l += 4, r += 4, o += 4)
+		{
+			const __m256d lm = _mm256_loadu_pd(l), rm = _mm256_loadu_pd(r);
+			const __m256d l0 = _mm256_permute_pd(lm, 0x0), r0 = _mm256_permute2f128_pd(rm, rm, 0x00);
+			const __m256d l1 = _mm256_permute_pd(lm, 0xF), r1 = _mm256_permute2f128_pd(rm, rm, 0x11);
+			const __m256d p = _mm256_mul_pd(l1, r1);
+			const __m256d error = _mm256_fmsub_pd(l1, r1, p);
+			_mm256_storeu_pd(o, _mm256_add_pd(_mm256_fmadd_pd(l0, r0, p), error));
+		}
+	}
+
+	//ad - bc = (ad - p) - (bc - p) with p = bc rounded, as compensatedDot(a, d, -b, c)
+	MAT2X2_TARGET("avx2,fma") inline __m256d compensatedDeterminant4(__m256d a, __m256d b, __m256d c, __m256d d)
+	{
+		const __m256d p = _mm256_mul_pd(b, c);
+		const __m256d error = _mm256_fmsub_pd(b, c, p);
+		return _mm256_sub_pd(_mm256_fmsub_pd(a, d, p), error);
+	}
+
+	MAT2X2_TARGET("avx2,fma") std::size_t inverseCompensatedAVX2(const Mat2x2* in, Mat2x2* out, std::size_t n)
+	{
+		const __m256d sign = _mm256_set1_pd(-0.0), zero = _mm256_setzero_pd();
+		const __m256d one = _mm256_set1_pd(1.0), limit = _mm256_set1_pd(invertibleLimit), nans = _mm256_set1_pd(nan);
+		std::size_t failed = 0, i = 0;
+		for (; i + 4 <= n; i += 4)
+		{
+			__m256d a, b, c, d;
+			load4(packed(in) + 4 * i, a, b, c, d);
+			const __m256d det = compensatedDeterminant4(a, b, c, d);
+			const __m256d bad = _mm256_or_pd(_mm256_cmp_pd(det, zero, _CMP_EQ_OQ),
+				_mm256_cmp_pd(_mm256_andnot_pd(sign, det), limit, _CMP_LE_OQ));
+			const __m256d r = _mm256_div_pd(one, det);
+			store4(packed(out) + 4 * i,
+				_mm256_blendv_pd(_mm256_mul_pd(d, r), nans, bad),
+				_mm256_blendv_pd(_mm256_mul_pd(_mm256_xor_pd(b, sign), r), nans, bad),
+				_mm256_blendv_pd(_mm256_mul_pd(_mm256_xor_pd(c, sign), r), nans, bad),
+				_mm256_blendv_pd(_mm256_mul_pd(a, r), nans, bad));
+			const int mask = _mm256_movemask_pd(bad);
+			failed += (mask & 1) + ((mask >> 1) & 1) + ((mask >> 2) & 1) + (mask >> 3);
+		}
+		for (; i < n; i++)
+			failed += invertWith(packed(in) + 4 * i, compensatedDeterminant(packed(in) + 4 * i), packed(out) + 4 * i);
+		return failed;
+	}
+
+	MAT2X2_TARGET("avx2,fma") void determinantTraceCompensatedAVX2(const Mat2x2* in, double* det, double* trace, std::size_t n)
+	{
+		std::size_t i = 0;
+		for (; i + 4 <= n; i += 4)
+		{
+			__m256d a, b, c, d;
+			load4(packed(in) + 4 * i, a, b, c, d);
+			_mm256_storeu_pd(det + i, compensatedDeterminant4(a, b, c, d));
+			_mm256_storeu_pd(trace + i, _mm256_add_pd(a, d));
+		}
+		for (; i < n; i++)
+		{
+			det[i] = compensatedDeterminant(packed(in) + 4 * i);
+			trace[i] = packed(in)[4 * i] + packed(in)[4 * i + 3];
+		}
+	}
+
+	MAT2X2_TARGET("avx2,fma") void eigenvaluesCompensatedAVX2(const Mat2x2* in, Eigenvalues* out, std::size_t n)
+	{
+		std::size_t i = 0;
+		for (; i + 4 <= n; i += 4)
+		{
+			__m256d a, b, c, d;
+			load4(packed(in) + 4 * i, a, b, c, d);
+			storeEigenvalues4(reinterpret_cast<double*>(out + i), _mm256_add_pd(a, d), compensatedDeterminant4(a, b, c, d));
+		}
+		eigenvaluesCompensatedScalar(in + i, out + i, n - i);
+	}
+
+	struct Lanes4
+	{
+		static const std::size_t width = 4;
+		__m256d v;
+		Lanes4() {}
+		MAT2X2_TARGET("avx2") Lanes4(__m256d x) : v(x) {}
+		MAT2X2_TARGET("avx2") explicit Lanes4(double x) : v(_mm256_set1_pd(x)) {}
+	};
+
+	struct Mask4
+	{
+		__m256d v;
+	};
+
+	MAT2X2_TARGET("avx2") inline Lanes4 operator+(Lanes4 x, Lanes4 y) { return _mm256_add_pd(x.v, y.v); }
+	MAT2X2_TARGET("avx2") inline Lanes4 operator-(Lanes4 x, Lanes4 y) { return _mm256_sub_pd(x.v, y.v); }
+	MAT2X2_TARGET("avx2") inline Lanes4 operator*(Lanes4 x, Lanes4 y) { return _mm256_mul_pd(x.v, y.v); }
+	MAT2X2_TARGET("avx2") inline Lanes4 operator/(Lanes4 x, Lanes4 y) { return _mm256_div_pd(x.v, y.v); }
+	MAT2X2_TARGET("avx2") inline Lanes4 operator-(Lanes4 x) { return _mm256_xor_pd(x.v, _mm256_set1_pd(-0.0)); }
+	MAT2X2_TARGET("avx2") inline Lanes4 sqrtOf(Lanes4 x) { return _mm256_sqrt_pd(x.v); }
+	MAT2X2_TARGET("avx2") inline Lanes4 absOf(Lanes4 x) { return _mm256_andnot_pd(_mm256_set1_pd(-0.0), x.v); }
+	MAT2X2_TARGET("avx2") inline Lanes4 maxOf(Lanes4 x, Lanes4 y) { return _mm256_max_pd(x.v, y.v); }
+	MAT2X2_TARGET("avx2") inline Lanes4 minOf(Lanes4 x, Lanes4 y) { return _mm256_min_pd(x.v, y.v); }
+	MAT2X2_TARGET("avx2") inline Mask4 isEqual(Lanes4 x, Lanes4 y) { return { _mm256_cmp_pd(x.v, y.v, _CMP_EQ_OQ) }; }
+	MAT2X2_TARGET("avx2") inline Mask4 isLess(Lanes4 x, Lanes4 y) { return { _mm256_cmp_pd(x.v, y.v, _CMP_LT_OQ) }; }
+	MAT2X2_TARGET("avx2") inline Mask4 isGreaterEqual(Lanes4 x, Lanes4 y) { return { _mm256_cmp_pd(x.v, y.v, _CMP_GE_OQ) }; }
+	MAT2X2_TARGET("avx2") inline Lanes4 select(Mask4 mask, Lanes4 x, Lanes4 y) { return _mm256_blendv_pd(y.v, x.v, mask.v); }
+
+	MAT2X2_TARGET("avx2") inline Lanes4 powerOfTwoScale(Lanes4 largest)
+	{
+		const __m256d clamped = _mm256_min_pd(_mm256_max_pd(largest.v, _mm256_set1_pd(DBL_MIN)), _mm256_set1_pd(DBL_MAX / 2));
+		const __m256i bits = _mm256_and_si256(_mm256_castpd_si256(clamped), _mm256_set1_epi64x(exponentBits));
+		return _mm256_castsi256_pd(_mm256_sub_epi64(_mm256_set1_epi64x(scaleBitsOffset), bits));
+	}
+
+	MAT2X2_TARGET("avx2") inline void loadLanes(const double* p, Lanes4& a, Lanes4& b, Lanes4& c, Lanes4& d)
+	{
+		load4(p, a.v, b.v, c.v, d.v);
+	}
+
+	MAT2X2_TARGET("avx2") inline void storeLanes(double* p, Lanes4 x)
+	{
+		_mm256_storeu_pd(p, x.v);
+	}
+
+	MAT2X2_TARGET("avx2,fma") MAT2X2_FLATTEN void svdAVX2(const Mat2x2* in, SingularValueDecomposition* out, std::size_t n)
+	{
+		svdLanes<Lanes4>(in, out, n);
+	}
+
+	MAT2X2_TARGET("avx2,fma") MAT2X2_FLATTEN void polarAVX2(const Mat2x2* in, PolarDecomposition* out, std::size_t n)
+	{
+		polarLanes<Lanes4>(in, out, n);
+	}
+
+	MAT2X2_TARGET("avx2,fma") MAT2X2_FLATTEN void qrAVX2(const Mat2x2* in, QRDecomposition* out, std::size_t n)
+	{
+		qrLanes<Lanes4>(in, out, n);
+	}
+
+	MAT2X2_TARGET("avx2,fma") MAT2X2_FLATTEN void symmetricEigenAVX2(const Mat2x2* in, EigenDecomposition* out, std::size_t n)
+	{
+		symmetricEigenLanes<Lanes4>(in, out, n);
+	}
+
+	MAT2X2_TARGET("avx2,fma") MAT2X2_FLATTEN void conditionNumberAVX2(const Mat2x2* in, double* out, std::size_t n)
+	{
+		conditionNumberLanes<Lanes4>(in, out, n);
+	}
+
+	const BatchKernels avx2Kernels = { IsaLevel::AVX2, Arithmetic::Naive, addAVX2, subtractAVX2, multiplyAVX2, inverseAVX2, determinantTraceAVX2, eigenvaluesAVX2,
+		svdAVX2, polarAVX2, qrAVX2, symmetricEigenAVX2, conditionNumberAVX2 };
+	const BatchKernels avx2CompensatedKernels = { IsaLevel::AVX2, Arithmetic::Compensated, addAVX2, subtractAVX2,
+		multiplyCompensatedAVX2, inverseCompensatedAVX2, determinantTraceCompensatedAVX2, eigenvaluesCompensatedAVX2,
+		svdAVX2, polarAVX2, qrAVX2, symmetricEigenAVX2, conditionNumberAVX2 };
+
+	/*
+	* AVX-512, two matrices per register for products and eight matrices
+		per iteration for the element-wise kernels, transposed with two
+		rounds of two-source permutes. One-source sqrt, min, max and
+		permutes use their zero-masked forms with a full mask: GCC 12
+		builds the unmasked ones on an undefined register and warns that
+		it may be used uninitialised.
+	*/
+	MAT2X2_TARGET("avx512f") inline void load8(const double* p, __m512d& a, __m512d& b, __m512d& c, __m512d& d)
+	{
+		const __m512i firstHalves = _mm512_set_epi64(13, 9, 5, 1, 12, 8, 4, 0);
+		const __m512i secondHalves = _mm512_set_epi64(15, 11, 7, 3, 14, 10, 6, 2);
+		const __m512i low = _mm512_set_epi64(11, 10, 9, 8, 3, 2, 1, 0);
+		const __m512i high = _mm512_set_epi64(15, 14, 13, 12, 7, 6, 5, 4);
+		const __m512d m01 = _mm512_loadu_pd(p), m23 = _mm512_loadu_pd(p + 8);
+		const __m512d m45 = _mm512_loadu_pd(p + 16), m67 = _mm512_loadu_pd(p + 24);
+		//(a0 a1 a2 a3 b0 b1 b2 b3) and (c0 c1 c2 c3 d0 d1 d2 d3) of the first four, then of the last four
+		const __m512d ab03 = _mm512_permutex2var_pd(m01, firstHalves, m23);
+		const __m512d cd03 = _mm512_permutex2var_pd(m01, secondHalves, m23);
+		const __m512d ab47 = _mm512_permutex2var_pd(m45, firstHalves, m67);
+		const __m512d cd47 = _mm512_permutex2var_pd(m45, secondHalves, m67);
+		a = _mm512_permutex2var_pd(ab03, low, ab47);
+		b = _mm512_permutex2var_pd(ab03, high, ab47);
+		c = _mm512_permutex2var_pd(cd03, low, cd47);
+		d = _mm512_permutex2var_pd(cd03, high, cd47);
+	}
+
+	MAT2X2_TARGET("avx512f") inline void store8(double* p, __m512d a, __m512d b, __m512d c, __m512d d)
+	{
+		const __m512i firstHalves = _mm512_set_epi64(13, 9, 5, 1, 12, 8, 4, 0);
+		const __m512i secondHalves = _mm512_set_epi64(15, 11, 7, 3, 14, 10, 6, 2);
+		const __m512i low = _mm512_set_epi64(11, 10, 9, 8, 3, 2, 1, 0);
+		const __m512i high = _mm512_set_epi64(15, 14, 13, 12, 7, 6, 5, 4);
+		const __m512d ab03 = _mm512_permutex2var_pd(a, low, b);
+		const __m512d ab47 = _mm512_permutex2var_pd(a, high, b);
+		const __m512d cd03 = _mm512_permutex2var_pd(c, low, d);
+		const __m512d cd47 = _mm512_permutex2var_pd(c, high, d);
+		_mm512_storeu_pd(p, _mm512_permutex2var_pd(ab03, firstHalves, cd03));
+		_mm512_storeu_pd(p + 8, _mm512_permutex2var_pd(ab03, secondHalves, cd03));
+		_mm512_storeu_pd(p + 16, _mm512_permutex2var_pd(ab47, firstHalves, cd47));
+		_mm512_storeu_pd(p + 24, _mm512_permutex2var_pd(ab47, secondHalves, cd47));
+	}
+
+	inline std::size_t bitCount(unsigned mask)
+	{
+		std::size_t count = 0;
+		for (; mask != 0; mask &= mask - 1)
+			count++;
+		return count;
+	}
+
+	MAT2X2_TARGET("avx512f") void addAVX512(const Mat2x2* lhs, const Mat2x2* rhs, Mat2x2* out, std::size_t n)
+	{
+		std::size_t k = 0;
+		for (; k + 8 <= 4 * n; k += 8)
+			_mm512_storeu_pd(packed(out) + k, _mm512_add_pd(_mm512_loadu_pd(packed(lhs) + k), _mm512_loadu_pd(packed(rhs) + k)));
+		for (; k < 4 * n; k++)
+			packed(out)[k] = packed(lhs)[k] + packed(rhs)[k];
+	}
+
+	MAT2X2_TARGET("avx512f") void subtractAVX512(const Mat2x2* lhs, const Mat2x2* rhs, Mat2x2* out, std::size_t n)
+	{
+		std::size_t k = 0;
+		for (; k + 8 <= 4 * n; k += 8)
+			_mm512_storeu_pd(packed(out) + k, _mm512_sub_pd(_mm512_loadu_pd(packed(lhs) + k), _mm512_loadu_pd(packed(rhs) + k)));
+		for (; k < 4 * n; k++)
+			packed(out)[k] = packed(lhs)[k] - packed(rhs)[k];
+	}
+
+	MAT2X2_TARGET("avx512f") void multiplyAVX512(const Mat2x2* lhs, const Mat2x2* rhs, Mat2x2* out, std::size_t n)
+	{
+		const double* l = packed(lhs);
+		const double* r = packed(rhs);
+		double* o = packed(out);
+		std::size_t i = 0;
+		for (; i + 2 <= n; i += 2, l += 8, r += 8, o += 8)
+		{
+			const __m512d lm = _mm512_loadu_pd(l), rm = _mm512_loadu_pd(r);
+			//(a a c c) * (a' b' a' b') + (b b d d) * (c' d' c' d') for each of the two matrices
+			const __m512d product = _mm512_add_pd(
+				_mm512_mul_pd(_mm512_maskz_permute_pd(0xFF, lm, 0x00), _mm512_maskz_permutex_pd(0xFF, rm, 0x44)),
+				_mm512_mul_pd(_mm512_maskz_permute_pd(0xFF, lm, 0xFF), _mm512_maskz_permutex_pd(0xFF, rm, 0xEE)));
+			_mm512_storeu_pd(o, product);
+		}
+		for (; i < n; i++, l += 4, r += 4, o += 4)
+			multiplyOne(l, r, o);
+	}
+
+	MAT2X2_TARGET("avx512f") std::size_t inverseAVX512(const Mat2x2* in, Mat2x2* out, std::size_t n)
+	{
+		const __m512d zero = _mm512_setzero_pd(), one = _mm512_set1_pd(1.0);
+		const __m512d limit = _mm512_set1_pd(invertibleLimit), nans = _mm512_set1_pd(nan);
+		std::size_t failed = 0, i = 0;
+		for (; i + 8 <= n; i += 8)
+		{
+			__m512d a, b, c, d;
+			load8(packed(in) + 4 * i, a, b, c, d);
+			const __m512d det = _mm512_sub_pd(_mm512_mul_pd(a, d), _mm512_mul_pd(b, c));
+			const __mmask8 bad = _mm512_cmp_pd_mask(det, zero, _CMP_EQ_OQ)
+				| _mm512_cmp_pd_mask(_mm512_abs_pd(det), limit, _CMP_LE_OQ);
+			const __m512d r = _mm512_div_pd(one, det);
+			store8(packed(out) + 4 * i,
+				_mm512_mask_blend_pd(bad, _mm512_mul_pd(d, r), nans),
+				_mm512_mask_blend_pd(bad, _mm512_mul_pd(_mm512_sub_pd(zero, b), r), nans),
+				_mm512_mask_blend_pd(bad, _mm512_mul_pd(_mm512_sub_pd(zero, c), r), nans),
+				_mm512_mask_blend_pd(bad, _mm512_mul_pd(a, r), nans));
+			failed += bitCount(bad);
+		}
+		for (; i < n; i++)
+			failed += inverseOne(packed(in) + 4 * i, packed(out) + 4 * i);
+		return failed;
+	}
+
+	MAT2X2_TARGET("avx512f") void determinantTraceAVX512(const Mat2x2* in, double* det, double* trace, std::size_t n)
+	{
+		std::size_t i = 0;
+		for (; i + 8 <= n; i += 8)
+		{
+			__m512d a, b, c, d;
+			load8(packed(in) + 4 * i, a, b, c, d);
+			_mm512_storeu_pd(det + i, _mm512_sub_pd(_mm512_mul_pd(a, d), _mm512_mul_pd(b, c)));
+			_mm512_storeu_pd(trace + i, _mm512_add_pd(a, d));
+		}
+		for (; i < n; i++)
+			determinantTraceOne(packed(in) + 4 * i, det + i, trace + i);
+	}
+
+	//eigenvalues() of eight matrices from their traces and determinants
+	MAT2X2_TARGET("avx512f") inline void storeEigenvalues8(double* p, __m512d t, __m512d det)
+	{
+		const __m512d zero = _mm512_setzero_pd();
+		const __m512d half = _mm512_set1_pd(0.5), four = _mm512_set1_pd(4.0);
+		const __m512d z = _mm512_sub_pd(_mm512_mul_pd(t, t), _mm512_mul_pd(four, det));
+		const __m512d root = _mm512_mul_pd(_mm512_maskz_sqrt_pd(0xFF, _mm512_abs_pd(z)), half);
+		const __m512d mid = _mm512_mul_pd(t, half);
+		const __mmask8 real = _mm512_cmp_pd_mask(z, zero, _CMP_GE_OQ);
+		store8(p,
+			_mm512_mask_blend_pd(real, mid, _mm512_add_pd(mid, root)),
+			_mm512_mask_blend_pd(real, root, zero),
+			_mm512_mask_blend_pd(real, mid, _mm512_sub_pd(mid, root)),
+			_mm512_mask_blend_pd(real, _mm512_sub_pd(zero, root), zero));
+	}
+
+	MAT2X2_TARGET("avx512f") void eigenvaluesAVX512(const Mat2x2* in, Eigenvalues* out, std::size_t n)
+	{
+		std::size_t i = 0;
+		for (; i + 8 <= n; i += 8)
+		{
+			__m512d a, b, c, d;
+			load8(packed(in) + 4 * i, a, b, c, d);
+			storeEigenvalues8(reinterpret_cast<double*>(out + i), _mm512_add_pd(a, d), _mm512_sub_pd(_mm512_mul_pd(a, d), _mm512_mul_pd(b, c)));
+		}
+		eigenvaluesScalar(in + i, out + i, n - i);
+	}
+
+	//compensated AVX-512 kernels, the same operations as compensatedDot() lane by lane
+	MAT2X2_TARGET("avx512f") void multiplyCompensatedAVX512(const Mat2x2* lhs, const Mat2x2* rhs, Mat2x2* out, std::size_t n)
+	{
+		const double* l = packed(lhs);
+		const double* r = packed(rhs);
+		double* o = packed(out);
+		std::size_t i = 0;
+		for (; i + 2 <= n; i += 2, l += 8, r += 8, o += 8)
+		{
+			const __m512d lm = _mm512_loadu_pd(l), rm = _mm512_loadu_pd(r);
+			const __m512d l0 = _mm512_maskz_permute_pd(0xFF, lm, 0x00), r0 = _mm512_maskz_permutex_pd(0xFF, rm, 0x44);
+			const __m512d l1 = _mm512_maskz_permute_pd(0xFF, lm, 0xFF), r1 = _mm512_maskz_permutex_pd(0xFF, rm, 0xEE);
+			const __m512d p = _mm512_mul_pd(l1, r1);
+			const __m512d error = _mm512_fmsub_pd(l1, r1, p);
+			_mm512_storeu_pd(o, _mm512_add_pd(_mm512_fmadd_pd(l0, r0, p), error));
+		}
+		for (; i < n; i++, l += 4, r += 4, o += 4)
+			multiplyCompensatedOne(l, r, o);
+	}
+
+	MAT2X2_TARGET("avx512f") inline __m512d compensatedDeterminant8(__m512d a, __m512d b, __m512d c, __m512d d)
+	{
+		const __m512d p = _mm512_mul_pd(b, c);
+		const __m512d error = _mm512_fmsub_pd(b, c, p);
+		return _mm512_sub_pd(_mm512_fmsub_pd(a, d, p), error);
+	}
+
+	MAT2X2_TARGET("avx512f") std::size_t inverseCompensatedAVX512(const Mat2x2* in, Mat2x2* out, std::size_t n)
+	{
+		const __m512d zero = _mm512_setzero_pd(), one = _mm512_set1_pd(1.0);
+		const __m512d limit = _mm512_set1_pd(invertibleLimit), nans = _mm512_set1_pd(nan);
+		std::size_t failed = 0, i = 0;
+		for (; i + 8 <= n; i += 8)
+		{
+			__m512d a, b, c, d;
+			load8(packed(in) + 4 * i, a, b, c, d);
+			const __m512d det = compensatedDeterminant8(a, b, c, d);
+			const __mmask8 bad = _mm512_cmp_pd_mask(det, zero, _CMP_EQ_OQ)
+				| _mm512_cmp_pd_mask(_mm512_abs_pd(det), limit, _CMP_LE_OQ);
+			const __m512d r = _mm512_div_pd(one, det);
+			store8(packed(out) + 4 * i,
+				_mm512_mask_blend_pd(bad, _mm512_mul_pd(d, r), nans),
+				_mm512_mask_blend_pd(bad, _mm512_mul_pd(_mm512_sub_pd(zero, b), r), nans),
+				_mm512_mask_blend_pd(bad, _mm512_mul_pd(_mm512_sub_pd(zero, c), r), nans),
+				_mm512_mask_blend_pd(bad, _mm512_mul_pd(a, r), nans));
+			failed += bitCount(bad);
+		}
+		for (; i < n; i++)
+			failed += invertWith(packed(in) + 4 * i, compensatedDeterminant(packed(in) + 4 * i), packed(out) + 4 * i);
+		return failed;
+	}
+
+	MAT2X2_TARGET("avx512f") void determinantTraceCompensatedAVX512(const Mat2x2* in, double* det, double* trace, std::size_t n)
+	{
+		std::size_t i = 0;
+		for (; i + 8 <= n; i += 8)
+		{
+			__m512d a, b, c, d;
+			load8(packed(in) + 4 * i, a, b, c, d);
+			_mm512_storeu_pd(det + i, compensatedDeterminant8(a, b, c, d));
+			_mm512_storeu_pd(trace + i, _mm512_add_pd(a, d));
+		}
+		for (; i < n; i++)
+		{
+			det[i] = compensatedDeterminant(packed(in) + 4 * i);
+			trace[i] = packed(in)[4 * i] + packed(in)[4 * i + 3];
+		}
+	}
+
+	MAT2X2_TARGET("avx512f") void eigenvaluesCompensatedAVX512(const Mat2x2* in, Eigenvalues* out, std::size_t n)
+	{
+		std::size_t i = 0;
+		for (; i + 8 <= n; i += 8)
+		{
+			__m512d a, b, c, d;
+			load8(packed(in) + 4 * i, a, b, c, d);
+			storeEigenvalues8(reinterpret_cast<double*>(out + i), _mm512_add_pd(a, d), compensatedDeterminant8(a, b, c, d));
+		}
+		eigenvaluesCompensatedScalar(in + i, out + i, n - i);
+	}
+
+	struct Lanes8
+	{
+		static const std::size_t width = 8;
+		__m512d v;
+		Lanes8() {}
+		MAT2X2_TARGET("avx512f") Lanes8(__m512d x) : v(x) {}
+		MAT2X2_TARGET("avx512f") explicit Lanes8(double x) : v(_mm512_set1_pd(x)) {}
+	};
+
+	struct Mask8
+	{
+		__mmask8 m;
+	};
+
+	MAT2X2_TARGET("avx512f") inline Lanes8 operator+(Lanes8 x, Lanes8 y) { return _mm512_add_pd(x.v, y.v); }
+	MAT2X2_TARGET("avx512f") inline Lanes8 operator-(Lanes8 x, Lanes8 y) { return _mm512_sub_pd(x.v, y.v); }
+	MAT2X2_TARGET("avx512f") inline Lanes8 operator*(Lanes8 x, Lanes8 y) { return _mm512_mul_pd(x.v, y.v); }
+	MAT2X2_TARGET("avx512f") inline Lanes8 operator/(Lanes8 x, Lanes8 y) { return _mm512_div_pd(x.v, y.v); }
+	//AVX-512F has no floating point xor, flip the sign bit as an integer
+	MAT2X2_TARGET("avx512f") inline Lanes8 operator-(Lanes8 x)
+	{
+		return _mm512_castsi512_pd(_mm512_xor_si512(_mm512_castpd_si512(x.v), _mm512_set1_epi64(static_cast<long long>(1ULL << 63))));
+	}
+	//the zero-masked forms, see load8()
+	MAT2X2_TARGET("avx512f") inline Lanes8 sqrtOf(Lanes8 x) { return _mm512_maskz_sqrt_pd(0xFF, x.v); }
+	MAT2X2_TARGET("avx512f") inline Lanes8 absOf(Lanes8 x) { return _mm512_abs_pd(x.v); }
+	MAT2X2_TARGET("avx512f") inline Lanes8 maxOf(Lanes8 x, Lanes8 y) { return _mm512_maskz_max_pd(0xFF, x.v, y.v); }
+	MAT2X2_TARGET("avx512f") inline Lanes8 minOf(Lanes8 x, Lanes8 y) { return _mm512_maskz_min_pd(0xFF, x.v, y.v); }
+	MAT2X2_TARGET("avx512f") inline Mask8 isEqual(Lanes8 x, Lanes8 y) { return { _mm512_cmp_pd_mask(x.v, y.v, _CMP_EQ_OQ) }; }
+	MAT2X2_TARGET("avx512f") inline Mask8 isLess(Lanes8 x, Lanes8 y) { return { _mm512_cmp_pd_mask(x.v, y.v, _CMP_LT_OQ) }; }
+	MAT2X2_TARGET("avx512f") inline Mask8 isGreaterEqual(Lanes8 x, Lanes8 y) { return { _mm512_cmp_pd_mask(x.v, y.v, _CMP_GE_OQ) }; }
+	MAT2X2_TARGET("avx512f") inline Lanes8 select(Mask8 mask, Lanes8 x, Lanes8 y) { return _mm512_mask_blend_pd(mask.m, y.v, x.v); }
+
+	MAT2X2_TARGET("avx512f") inline Lanes8 powerOfTwoScale(Lanes8 largest)
+	{
+		const __m512d clamped = _mm512_maskz_min_pd(0xFF, _mm512_maskz_max_pd(0xFF, largest.v, _mm512_set1_pd(DBL_MIN)), _mm512_set1_pd(DBL_MAX / 2));
+		const __m512i bits = _mm512_and_si512(_mm512_castpd_si512(clamped), _mm512_set1_epi64(exponentBits));
+		return _mm512_castsi512_pd(_mm512_sub_epi64(_mm512_set1_epi64(scaleBitsOffset), bits));
+	}
+
+	MAT2X2_TARGET("avx512f") inline void loadLanes(const double* p, Lanes8& a, Lanes8& b, Lanes8& c, Lanes8& d)
+	{
+		load8(p, a.v, b.v, c.v, d.v);
+	}
+
+	MAT2X2_TARGET("avx512f") inline void storeLanes(double* p, Lanes8 x)
+	{
+		_mm512_storeu_pd(p, x.v);
+	}
+
+	MAT2X2_TARGET("avx512f") MAT2X2_FLATTEN void svdAVX512(const Mat2x2* in, SingularValueDecomposition* out, std::size_t n)
+	{
+		svdLanes<Lanes8>(in, out, n);
+	}
+
+	MAT2X2_TARGET("avx512f") MAT2X2_FLATTEN void polarAVX512(const Mat2x2* in, PolarDecomposition* out, std::size_t n)
+	{
+		polarLanes<Lanes8>(in, out, n);
+	}
+
+	MAT2X2_TARGET("avx512f") MAT2X2_FLATTEN void qrAVX512(const Mat2x2* in, QRDecomposition* out, std::size_t n)
+	{
+		qrLanes<Lanes8>(in, out, n);
+	}
+
+	MAT2X2_TARGET("avx512f") MAT2X2_FLATTEN void symmetricEigenAVX512(const Mat2x2* in, EigenDecomposition* out, std::size_t n)
+	{
+		symmetricEigenLanes<Lanes8>(in, out, n);
+	}
+
+	MAT2X2_TARGET("avx512f") MAT2X2_FLATTEN void conditionNumberAVX512(const Mat2x2* in, double* out, std::size_t n)
+	{
+		conditionNumberLanes<Lanes8>(in, out, n);
+	}
+
+	const BatchKernels avx512Kernels = { IsaLevel::AVX512, Arithmetic::Naive, addAVX512, subtractAVX512, multiplyAVX512, inverseAVX512, determinantTraceAVX512, eigenvaluesAVX512,
+		svdAVX512, polarAVX512, qrAVX512, symmetricEigenAVX512, conditionNumberAVX512 };
+	const BatchKernels avx512CompensatedKernels = { IsaLevel::AVX512, Arithmetic::Compensated, addAVX512, subtractAVX512,
+		multiplyCompensatedAVX512, inverseCompensatedAVX512, determinantTraceCompensatedAVX512, eigenvaluesCompensatedAVX512,
+		svdAVX512, polarAVX512, qrAVX512, symmetricEigenAVX512, conditionNumberAVX512 };
+
+#if defined(_MSC_VER)
+	IsaLevel detectX86()
+	{
+		int info[4];
+		__cpuid(info, 0);
+		const int maxLeaf = info[0];
+		__cpuid(info, 1);
+		const bool sse2 = (info[3] & (1 << 26)) != 0;
+		const bool osxsave = (info[2] & (1 << 27)) != 0;
+		const bool avx = (info[2] & (1 << 28)) != 0;
+		const bool fma = (info[2] & (1 << 12)) != 0;
+		if (!sse2)
+			return IsaLevel::Scalar;
+		if (!osxsave || !avx || maxLeaf < 7)
+			return IsaLevel::SSE2;
+		//the operating system must save the vector registers on a context switch
+		const unsigned long long xcr0 = _xgetbv(0);
+		if ((xcr0 & 0x6) != 0x6)
+			return IsaLevel::SSE2;
+		__cpuidex(info, 7, 0);
+		const bool avx2 = (info[1] & (1 << 5)) != 0;
+		const bool avx512f = (info[1] & (1 << 16)) != 0;
+		if (avx512f && (xcr0 & 0xE6) == 0xE6)
+			return IsaLevel::AVX512;
+		return avx2 && fma ? IsaLevel::AVX2 : IsaLevel::SSE2;
+	}
+#else
+	IsaLevel detectX86()
+	{
+		//checks the CPUID bits and that the operating system enabled the registers
+		__builtin_cpu_init();
+		if (__builtin_cpu_supports("avx512f"))
+			return IsaLevel::AVX512;
+		if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+			return IsaLevel::AVX2;
+		if (__builtin_cpu_supports("sse2"))
+			return IsaLevel::SSE2;
+		return IsaLevel::Scalar;
+	}
+#endif
+#endif
+
+	IsaLevel chooseIsa()
+	{
+		IsaLevel level = detectIsa();
+		const char* forced = std::getenv("MAT2X2_ISA");
+		if (forced == nullptr)
+			return level;
+		const std::string name(forced);
+		for (IsaLevel candidate : { IsaLevel::Scalar, IsaLevel::SSE2, IsaLevel::AVX2, IsaLevel::AVX512 })
+		{
+			//a level the CPU lacks cannot be forced, the override only lowers it
+			if (name == isaName(candidate) && candidate < level)
+				level = candidate;
+		}
+		return level;
+	}
+
+	//equal, both NaN, or at most tolerance apart
+	bool close(double x, double y, double tolerance)
+	{
+		if (std::isnan(x) || std::isnan(y))
+			return std::isnan(x) && std::isnan(y);
+		return x == y || std::abs(x - y) <= tolerance;
+	}
+
+	bool close(const double* x, const double* y, double tolerance)
+	{
+		for (int k = 0; k < 4; k++)
+			if (!close(x[k], y[k], tolerance))
+				return false;
+		return true;
+	}
+
+	double largest(const double* m)
+	{
+		return std::max(std::max(std::abs(m[0]), std::abs(m[1])), std::max(std::abs(m[2]), std::abs(m[3])));
+	}
+
+	//o = x * y, or x * y^T when transposed
+	void product(const double* x, const double* y, bool transposed, double* o)
+	{
+		const double y1 = transposed ? y[2] : y[1], y2 = transposed ? y[1] : y[2];
+		o[0] = x[0] * y[0] + x[1] * y2;
+		o[1] = x[0] * y1 + x[1] * y[3];
+		o[2] = x[2] * y[0] + x[3] * y2;
+		o[3] = x[2] * y1 + x[3] * y[3];
+	}
+
+	//q^T * q is the identity within tolerance
+	bool orthogonal(const double* q, double tolerance)
+	{
+		const double identity[4] = { 1, 0, 0, 1 };
+		double t[4] = { q[0], q[2], q[1], q[3] }, o[4];
+		product(t, q, false, o);
+		return close(o, identity, tolerance);
+	}
+
+	//x * diag(first, second) * y^T is m within tolerance
+	bool reconstructs(const double* m, const double* x, double first, double second, const double* y, double tolerance)
+	{
+		const double scaled[4] = { x[0] * first, x[1] * second, x[2] * first, x[3] * second };
+		double o[4];
+		product(scaled, y, true, o);
+		return close(o, m, tolerance);
+	}
+
+	/*
+	* the angles of a decomposition are ill-conditioned when its values
+		nearly coincide, so each level is checked for what a decomposition
+		must satisfy (orthogonal factors that multiply back to the matrix)
+		and only its values are compared with the scalar kernels
+	*/
+	bool decompositionsAgree(const BatchKernels& test, const std::vector<Mat2x2>& in)
+	{
+		const BatchKernels& reference = kernels(IsaLevel::Scalar, test.arithmetic);
+		const double ulps = 64 * DBL_EPSILON;
+		const std::size_t n = in.size();
+		std::vector<SingularValueDecomposition> expectedSvd(n), actualSvd(n);
+		std::vector<PolarDecomposition> expectedPolar(n), actualPolar(n);
+		std::vector<QRDecomposition> expectedQr(n), actualQr(n);
+		std::vector<EigenDecomposition> expectedEigen(n), actualEigen(n);
+		reference.svd(in.data(), expectedSvd.data(), n);
+		test.svd(in.data(), actualSvd.data(), n);
+		reference.polar(in.data(), expectedPolar.data(), n);
+		test.polar(in.data(), actualPolar.data(), n);
+		reference.qr(in.data(), expectedQr.data(), n);
+		test.qr(in.data(), actualQr.data(), n);
+		reference.symmetricEigen(in.data(), expectedEigen.data(), n);
+		test.symmetricEigen(in.data(), actualEigen.data(), n);
+		for (std::size_t i = 0; i < n; i++)
+		{
+			const double* m = packed(&in[i]);
+			const double tolerance = ulps * largest(m);
+			const SingularValueDecomposition& s = actualSvd[i];
+			if (!close(s.sigma1, expectedSvd[i].sigma1, tolerance) || !close(s.sigma2, expectedSvd[i].sigma2, tolerance)
+				|| !orthogonal(packed(&s.u), ulps) || !orthogonal(packed(&s.v), ulps)
+				|| !reconstructs(m, packed(&s.u), s.sigma1, s.sigma2, packed(&s.v), tolerance))
+				return false;
+
+			const PolarDecomposition& p = actualPolar[i];
+			double rs[4];
+			product(packed(&p.r), packed(&p.s), false, rs);
+			if (!orthogonal(packed(&p.r), ulps) || !close(packed(&p.s), packed(&expectedPolar[i].s), tolerance)
+				|| !close(rs, m, tolerance))
+				return false;
+
+			const QRDecomposition& q = actualQr[i];
+			double qr[4];
+			product(packed(&q.q), packed(&q.r), false, qr);
+			if (!orthogonal(packed(&q.q), ulps) || packed(&q.r)[2] != 0
+				|| !close(packed(&q.r), packed(&expectedQr[i].r), tolerance) || !close(qr, m, tolerance))
+				return false;
+
+			//the kernels read c as b
+			const double symmetric[4] = { m[0], m[1], m[1], m[3] };
+			const EigenDecomposition& e = actualEigen[i];
+			if (!close(e.lambda1, expectedEigen[i].lambda1, tolerance) || !close(e.lambda2, expectedEigen[i].lambda2, tolerance)
+				|| !orthogonal(packed(&e.vectors), ulps)
+				|| !reconstructs(symmetric, packed(&e.vectors), e.lambda1, e.lambda2, packed(&e.vectors), tolerance))
+				return false;
+		}
+		return true;
+	}
+
+	/*
+	* a naive kernel may be compiled with fused multiply-adds where the
+		scalar one is not, so results are compared within the rounding
+		error of the terms they are computed from rather than of the
+		result. Compensated kernels round the same way on every level,
+		their products, inverses and determinants must match exactly.
+	*/
+	bool agrees(const BatchKernels& test, const std::vector<Mat2x2>& lhs, const std::vector<Mat2x2>& rhs)
+	{
+		const BatchKernels& reference = kernels(IsaLevel::Scalar, test.arithmetic);
+		const double ulps = test.arithmetic == Arithmetic::Compensated ? 0 : 8;
+		const std::size_t n = lhs.size();
+		std::vector<Mat2x2> expected(n), actual(n);
+		std::vector<Eigenvalues> expectedRoots(n), actualRoots(n);
+		std::vector<double> expectedDet(n), expectedTrace(n), actualDet(n), actualTrace(n);
+
+		//sums and differences are a single rounding on every level
+		reference.add(lhs.data(), rhs.data(), expected.data(), n);
+		test.add(lhs.data(), rhs.data(), actual.data(), n);
+		if (expected != actual)
+			return false;
+		reference.subtract(lhs.data(), rhs.data(), expected.data(), n);
+		test.subtract(lhs.data(), rhs.data(), actual.data(), n);
+		if (expected != actual)
+			return false;
+
+		reference.multiply(lhs.data(), rhs.data(), expected.data(), n);
+		test.multiply(lhs.data(), rhs.data(), actual.data(), n);
+		for (std::size_t i = 0; i < n; i++)
+		{
+			const double terms = 2 * largest(packed(&lhs[i])) * largest(packed(&rhs[i]));
+			if (!close(packed(&expected[i]), packed(&actual[i]), ulps * DBL_EPSILON * terms))
+				return false;
+		}
+
+		if (reference.inverse(lhs.data(), expected.data(), n) != test.inverse(lhs.data(), actual.data(), n))
+			return false;
+		for (std::size_t i = 0; i < n; i++)
+		{
+			//the determinant's rounding error is relative to |ad| + |bc|, not to itself
+			const double* m = packed(&lhs[i]);
+			const double terms = std::abs(m[0] * m[3]) + std::abs(m[1] * m[2]);
+			const double det = std::abs(m[0] * m[3] - m[1] * m[2]);
+			if (!close(packed(&expected[i]), packed(&actual[i]), ulps * DBL_EPSILON * largest(packed(&expected[i])) * terms / det))
+				return false;
+		}
+
+		reference.determinantTrace(lhs.data(), expectedDet.data(), expectedTrace.data(), n);
+		test.determinantTrace(lhs.data(), actualDet.data(), actualTrace.data(), n);
+		for (std::size_t i = 0; i < n; i++)
+		{
+			const double* m = packed(&lhs[i]);
+			const double terms = std::abs(m[0] * m[3]) + std::abs(m[1] * m[2]);
+			if (!close(expectedDet[i], actualDet[i], ulps * DBL_EPSILON * terms)
+				|| !close(expectedTrace[i], actualTrace[i], ulps * DBL_EPSILON * std::max(std::abs(m[0]), std::abs(m[3]))))
+				return false;
+		}
+
+		reference.eigenvalues(lhs.data(), expectedRoots.data(), n);
+		test.eigenvalues(lhs.data(), actualRoots.data(), n);
+		for (std::size_t i = 0; i < n; i++)
+		{
+			//the square root of a cancelling discriminant magnifies rounding to about sqrt(DBL_EPSILON)
+			const double* e = reinterpret_cast<const double*>(&expectedRoots[i]);
+			const double* a = reinterpret_cast<const double*>(&actualRoots[i]);
+			if (!close(e, a, 8 * std::sqrt(DBL_EPSILON) * largest(packed(&lhs[i]))))
+				return false;
+		}
+		std::vector<double> expectedCondition(n), actualCondition(n);
+		reference.conditionNumber(lhs.data(), expectedCondition.data(), n);
+		test.conditionNumber(lhs.data(), actualCondition.data(), n);
+		for (std::size_t i = 0; i < n; i++)
+		{
+			//sqrt(t^2 - 1) magnifies rounding to sqrt(DBL_EPSILON) near 1, the determinant's grows with its square
+			const double condition = expectedCondition[i];
+			if (!close(condition, actualCondition[i], 8 * std::sqrt(DBL_EPSILON) * condition + 8 * DBL_EPSILON * condition * condition))
+				return false;
+		}
+		return decompositionsAgree(test, lhs);
+	}
+}
+
+/*
+* @param  level - an instruction set level
+
+* @return the name MAT2X2_ISA uses for it
+*/
+const char* isaName(IsaLevel level)
+{
+	switch (level)
+	{
+	case IsaLevel::SSE2:
+		return "sse2";
+	case IsaLevel::AVX2:
+		return "avx2";
+	case IsaLevel::AVX512:
+		return "avx512";
+	default:
+		return "scalar";
+	}
+}
+
+/*
+* to find the best instruction set level of this machine
+
+* @return the level
+*/
+IsaLevel detectIsa()
+{
+#ifdef MAT2X2_X86
+	static const IsaLevel level = detectX86();
+	return level;
+#else
+	return IsaLevel::Scalar;
+#endif
+}
+
+/*
+* @return the level the batch kernels run at, fixed on first use
+*/
+IsaLevel activeIsa()
+{
+	static const IsaLevel level = chooseIsa();
+	return level;
+}
+
+/*
+* @return the kernels of the active level, with the arithmetic
+	Mat2x2::arithmetic() selects
+*/
+const BatchKernels& kernels()
+{
+	return kernels(activeIsa(), Mat2x2::arithmetic());
+}
+
+/*
+* to get the kernels of a specific level, for benchmarks and tests
+
+* @param  level - the instruction set level, at most detectIsa()
+* @param  arithmetic - Naive or Compensated products and determinants
+
+* @return the kernels
+*/
+const BatchKernels& kernels(IsaLevel level, Arithmetic arithmetic)
+{
+	if (level > detectIsa())
+		throw std::invalid_argument("instruction set not supported");
+	const bool compensated = arithmetic == Arithmetic::Compensated;
+#ifdef MAT2X2_X86
+	switch (level)
+	{
+	case IsaLevel::SSE2:
+		return compensated ? sse2CompensatedKernels : sse2Kernels;
+	case IsaLevel::AVX2:
+		return compensated ? avx2CompensatedKernels : avx2Kernels;
+	case IsaLevel::AVX512:
+		return compensated ? avx512CompensatedKernels : avx512Kernels;
+	default:
+		break;
+	}
+#endif
+	return compensated ? scalarCompensatedKernels : scalarKernels;
+}
+
+/*
+* to check every supported level and arithmetic against the scalar kernels on random,
+	singular and complex-eigenvalue matrices, including batch sizes that
+	leave a scalar tail
+
+* @param  samples - the number of matrices per distribution
+
+* @return true if every level agrees with the scalar kernels
+*/
+bool selfTest(std::size_t samples)
+{
+	const Distribution distributions[] = { Distribution::Uniform, Distribution::Singular,
+		Distribution::ComplexEigenvalues, Distribution::Symmetric };
+	for (Distribution distribution : distributions)
+	{
+		//an odd size exercises the tail of every vector width
+		std::vector<Mat2x2> lhs = generate(distribution, samples | 7, 35);
+		std::vector<Mat2x2> rhs = generate(Distribution::Uniform, samples | 7, 36);
+		for (int level = static_cast<int>(IsaLevel::SSE2); level <= static_cast<int>(detectIsa()); level++)
+		{
+			if (!agrees(kernels(static_cast<IsaLevel>(level), Arithmetic::Naive), lhs, rhs)
+				|| !agrees(kernels(static_cast<IsaLevel>(level), Arithmetic::Compensated), lhs, rhs))
+				return false;
+		}
+	}
+	return true;
+}
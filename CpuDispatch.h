@@ -0,0 +1,70 @@
+#ifndef CPUDISPATCH_H
+#define CPUDISPATCH_H
+#include<cstddef>
+#include"Mat2x2.h"
+#include"Decomposition.h"
+
+enum class IsaLevel
+{
+	Scalar,
+	SSE2,
+	AVX2,
+	AVX512
+};
+
+/*
+* batch kernels for one instruction set and arithmetic. Every variant
+	computes the same expressions as the scalar one. Naive results agree
+	with it up to the compiler's floating point contraction. Compensated
+	tables use Kahan's FMA products (see Compensated.h) for multiply,
+	inverse and determinantTrace and give the same bits on every level;
+	their eigenvalues use the compensated determinant too.
+
+* add, subtract, multiply - out[i] = lhs[i] + rhs[i], lhs[i] - rhs[i]
+	and lhs[i] * rhs[i], out may be lhs or rhs
+* inverse - out[i] = in[i].inverse(), all NaN where inverse() would
+	throw, returns how many matrices had no inverse
+* determinantTrace - det[i] and trace[i] of in[i]
+* eigenvalues - out[i] = eigenvalues(in[i]) with the determinant of
+	the table's arithmetic, whatever Mat2x2::arithmetic() is
+* svd, polar, qr, symmetricEigen - out[i] = svd(in[i]) and so on, the
+	closed forms of ClosedForm.h on one transposed register of matrices
+	at a time; symmetricEigen takes c equal to b and does not check it
+* conditionNumber - out[i] = the 2-norm condition number of in[i], NaN
+	for the zero matrix
+*/
+struct BatchKernels
+{
+	IsaLevel level;
+	Arithmetic arithmetic;
+	void (*add)(const Mat2x2*, const Mat2x2*, Mat2x2*, std::size_t);
+	void (*subtract)(const Mat2x2*, const Mat2x2*, Mat2x2*, std::size_t);
+	void (*multiply)(const Mat2x2*, const Mat2x2*, Mat2x2*, std::size_t);
+	std::size_t (*inverse)(const Mat2x2*, Mat2x2*, std::size_t);
+	void (*determinantTrace)(const Mat2x2*, double*, double*, std::size_t);
+	void (*eigenvalues)(const Mat2x2*, Eigenvalues*, std::size_t);
+	void (*svd)(const Mat2x2*, SingularValueDecomposition*, std::size_t);
+	void (*polar)(const Mat2x2*, PolarDecomposition*, std::size_t);
+	void (*qr)(const Mat2x2*, QRDecomposition*, std::size_t);
+	void (*symmetricEigen)(const Mat2x2*, EigenDecomposition*, std::size_t);
+	void (*conditionNumber)(const Mat2x2*, double*, std::size_t);
+};
+
+const char* isaName(IsaLevel);
+
+//the best level this CPU and operating system support, AVX2 also needs FMA3
+IsaLevel detectIsa();
+
+/*
+* the level in use, chosen once on first use: detectIsa(), lowered by
+	the MAT2X2_ISA environment variable (scalar, sse2, avx2 or avx512)
+	when it names a lower level
+*/
+IsaLevel activeIsa();
+
+const BatchKernels& kernels();
+const BatchKernels& kernels(IsaLevel, Arithmetic = Arithmetic::Naive);
+
+//checks every level the CPU supports against the scalar kernels
+bool selfTest(std::size_t = 100000);
+#endif
@@ -0,0 +1,186 @@
+#include "Decomposition.h"
+#include "ClosedForm.h"
+#include "CpuDispatch.h"
+#include<cmath>
+#include<stdexcept>
+
+/*
+* to find both eigenvalues of the matrix at once, with the same
+	formula as operator() but without allocating a vector per root
+
+* @param  m - a referrence to a 2x2 matrix
+
+* @return the two eigenvalues
+*/
+Eigenvalues eigenvalues(const Mat2x2& m)
+{
+	const double t = m.trace();
+	const double z = t * t - 4 * m.determinant();
+	const double root = std::sqrt(std::abs(z)) / 2;
+	Eigenvalues result;
+	if (z >= 0)
+	{
+		result.re1 = t / 2 + root;
+		result.re2 = t / 2 - root;
+		result.im1 = 0;
+		result.im2 = 0;
+	}
+	else
+	{
+		result.re1 = t / 2;
+		result.re2 = t / 2;
+		result.im1 = root;
+		result.im2 = -root;
+	}
+	return result;
+}
+
+/*
+* to find the singular value decomposition of the matrix
+
+* @param  m - a referrence to a 2x2 matrix
+
+* @return the rotations u, v and the singular values
+*/
+SingularValueDecomposition svd(const Mat2x2& m)
+{
+	const double* v = m.data();
+	double o[10];
+	svdClosedForm(v[0], v[1], v[2], v[3], o);
+	SingularValueDecomposition result;
+	result.u = Mat2x2(o[0], o[1], o[2], o[3]);
+	result.sigma1 = o[4];
+	result.sigma2 = o[5];
+	result.v = Mat2x2(o[6], o[7], o[8], o[9]);
+	return result;
+}
+
+/*
+* to find the polar decomposition of the matrix
+
+* @param  m - a referrence to a 2x2 matrix
+
+* @return the orthogonal factor r and the symmetric factor s
+*/
+PolarDecomposition polar(const Mat2x2& m)
+{
+	const double* v = m.data();
+	double o[8];
+	polarClosedForm(v[0], v[1], v[2], v[3], o);
+	PolarDecomposition result;
+	result.r = Mat2x2(o[0], o[1], o[2], o[3]);
+	result.s = Mat2x2(o[4], o[5], o[6], o[7]);
+	return result;
+}
+
+/*
+* to find the QR decomposition of the matrix using a single Givens rotation
+
+* @param  m - a referrence to a 2x2 matrix
+
+* @return the orthogonal factor q and the upper triangular factor r
+*/
+QRDecomposition qr(const Mat2x2& m)
+{
+	const double* v = m.data();
+	double o[8];
+	qrClosedForm(v[0], v[1], v[2], v[3], o);
+	QRDecomposition result;
+	result.q = Mat2x2(o[0], o[1], o[2], o[3]);
+	result.r = Mat2x2(o[4], o[5], o[6], o[7]);
+	return result;
+}
+
+/*
+* to find the eigenvalues and eigenvectors of a symmetric matrix
+
+* @param  m - a referrence to a symmetric 2x2 matrix
+
+* @return the eigenvalues in decreasing order and the eigenvectors as columns
+*/
+EigenDecomposition symmetricEigen(const Mat2x2& m)
+{
+	const double* v = m.data();
+	if (v[1] != v[2])
+		throw std::invalid_argument("Matrix not symmetric");
+	double o[6];
+	symmetricEigenClosedForm(v[0], v[1], v[3], o);
+	EigenDecomposition result;
+	result.lambda1 = o[0];
+	result.lambda2 = o[1];
+	result.vectors = Mat2x2(o[2], o[3], o[4], o[5]);
+	return result;
+}
+
+/*
+* batched eigenvalues
+
+* @param  in - pointer to the first matrix
+* @param  n - the number of matrices
+* @param  resource - the memory resource the result is allocated from
+
+* @return a vector with the eigenvalues of every matrix
+*/
+std::pmr::vector<Eigenvalues> eigenvalues(const Mat2x2* in, std::size_t n, std::pmr::memory_resource* resource)
+{
+	std::pmr::vector<Eigenvalues> result(n, resource);
+	for (std::size_t i = 0; i < n; i++)
+		result[i] = eigenvalues(in[i]);
+	return result;
+}
+
+/*
+* batched singular value decomposition, on the vectorised kernels of
+	the active instruction set level
+
+* @param  in - pointer to the first matrix
+* @param  out - pointer to the first result
+* @param  n - the number of matrices
+*/
+void svd(const Mat2x2* in, SingularValueDecomposition* out, std::size_t n)
+{
+	kernels().svd(in, out, n);
+}
+
+/*
+* batched polar decomposition, on the vectorised kernels of the active
+	instruction set level
+
+* @param  in - pointer to the first matrix
+* @param  out - pointer to the first result
+* @param  n - the number of matrices
+*/
+void polar(const Mat2x2* in, PolarDecomposition* out, std::size_t n)
+{
+	kernels().polar(in, out, n);
+}
+
+/*
+* batched QR decomposition, on the vectorised kernels of the active
+	instruction set level
+
+* @param  in - pointer to the first matrix
+* @param  out - pointer to the first result
+* @param  n - the number of matrices
+*/
+void qr(const Mat2x2* in, QRDecomposition* out, std::size_t n)
+{
+	kernels().qr(in, out, n);
+}
+
+/*
+* batched symmetric eigen decomposition, on the vectorised kernels of
+	the active instruction set level, throws before computing anything
+	if a matrix is not symmetric
+
+* @param  in - pointer to the first symmetric matrix
+* @param  out - pointer to the first result
+* @param  n - the number of matrices
+*/
+void symmetricEigen(const Mat2x2* in, EigenDecomposition* out, std::size_t n)
+{
+	for (std::size_t i = 0; i < n; i++)
+		if (in[i][1] != in[i][2])
+			throw std::invalid_argument("Matrix not symmetric");
+	kernels().symmetricEigen(in, out, n);
+}
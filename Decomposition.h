@@ -0,0 +1,74 @@
+#ifndef DECOMPOSITION_H
+#define DECOMPOSITION_H
+#include<cstddef>
+#include<memory_resource>
+#include<vector>
+#include"Mat2x2.h"
+
+/*
+* m = u * |sigma1 0     | * v^T
+		  |0      sigma2|
+
+	u and v are orthogonal and sigma1 >= sigma2 >= 0
+*/
+struct SingularValueDecomposition
+{
+	Mat2x2 u;
+	double sigma1, sigma2;
+	Mat2x2 v;
+};
+
+/*
+* m = r * s, r orthogonal and s symmetric positive semi-definite
+*/
+struct PolarDecomposition
+{
+	Mat2x2 r;
+	Mat2x2 s;
+};
+
+/*
+* m = q * r, q orthogonal and r upper triangular
+*/
+struct QRDecomposition
+{
+	Mat2x2 q;
+	Mat2x2 r;
+};
+
+/*
+* m = vectors * |lambda1 0      | * vectors^T
+				|0       lambda2|
+
+	for a symmetric m, the columns of vectors are the unit
+	eigenvectors and lambda1 >= lambda2
+*/
+struct EigenDecomposition
+{
+	double lambda1, lambda2;
+	Mat2x2 vectors;
+};
+
+/*
+* the two roots of the characteristic polynomial, lambda1 = re1 + i im1
+	and lambda2 = re2 + i im2, in the order operator()(1) and operator()(2) return them
+*/
+struct Eigenvalues
+{
+	double re1, im1;
+	double re2, im2;
+};
+
+Eigenvalues eigenvalues(const Mat2x2&);
+SingularValueDecomposition svd(const Mat2x2&);
+PolarDecomposition polar(const Mat2x2&);
+QRDecomposition qr(const Mat2x2&);
+EigenDecomposition symmetricEigen(const Mat2x2&);
+
+//Batched variants, out[i] is the decomposition of in[i]
+std::pmr::vector<Eigenvalues> eigenvalues(const Mat2x2*, std::size_t, std::pmr::memory_resource* = std::pmr::get_default_resource());
+void svd(const Mat2x2*, SingularValueDecomposition*, std::size_t);
+void polar(const Mat2x2*, PolarDecomposition*, std::size_t);
+void qr(const Mat2x2*, QRDecomposition*, std::size_t);
+void symmetricEigen(const Mat2x2*, EigenDecomposition*, std::size_t);
+#endif
@@ -0,0 +1,461 @@
+#include "Interval.h"
+#include<algorithm>
+#include<cmath>
+#include<cstdint>
+#include<cstring>
+#include<iomanip>
+#include<limits>
+#include<stdexcept>
+
+namespace
+{
+	const double inf = std::numeric_limits<double>::infinity();
+
+	/*
+	* below this magnitude the rounding error of a product, quotient or
+		square root may itself underflow, so an FMA can no longer tell
+		its sign. 2^-969 leaves the 106 bits of an exact product above
+		the subnormal range.
+	*/
+	const double exactLimit = std::ldexp(1.0, -969);
+
+	/*
+	* the next double below and above x, stepping its bits
+		rather than calling std::nextafter, which also handles NaN and
+		errno and costs a library call on every rounded result
+	*/
+	double down(double x)
+	{
+		if (x == 0)
+			return -std::numeric_limits<double>::denorm_min();
+		if (x == inf)
+			return std::numeric_limits<double>::max();
+		if (x == -inf)
+			return x;
+		std::int64_t bits;
+		std::memcpy(&bits, &x, sizeof bits);
+		bits += x > 0 ? -1 : 1;
+		std::memcpy(&x, &bits, sizeof x);
+		return x;
+	}
+
+	double up(double x)
+	{
+		return -down(-x);
+	}
+
+	//x rounded to nearest, widened by one ulp on both sides
+	Interval widened(double x)
+	{
+		if (std::isnan(x))
+			return Interval(-inf, inf);
+		return Interval(down(x), up(x));
+	}
+
+	/*
+	* x rounded to nearest, widened by one ulp towards the exact value
+		x + error. The sign of error is random, selects instead of
+		branches keep it from costing a misprediction per result
+	*/
+	Interval rounded(double x, double error)
+	{
+		const double below = down(x), above = up(x);
+		return Interval(error < 0 ? below : x, error > 0 ? above : x);
+	}
+
+	Interval sumOf(double x, double y)
+	{
+		const double s = x + y;
+		if (!std::isfinite(s))
+			return widened(s);
+		//TwoSum, s + error == x + y exactly
+		const double yy = s - x;
+		const double error = (x - (s - yy)) + (y - yy);
+		return rounded(s, error);
+	}
+
+	Interval productOf(double x, double y)
+	{
+		//0 * inf is 0 for the end of an unbounded interval
+		if (x == 0 || y == 0)
+			return Interval(0);
+		const double p = x * y;
+		if (!std::isfinite(p) || std::abs(p) < exactLimit)
+			return widened(p);
+		//TwoProduct, p + error == x * y exactly
+		return rounded(p, std::fma(x, y, -p));
+	}
+
+	Interval quotientOf(double x, double y)
+	{
+		if (x == 0)
+			return Interval(0);
+		const double q = x / y;
+		if (!std::isfinite(q) || std::abs(q) < exactLimit || std::abs(x) < exactLimit)
+			return widened(q);
+		//x - q * y is exact, and x / y - q has its sign divided by the sign of y
+		const double remainder = std::fma(-q, y, x);
+		return rounded(q, y > 0 ? remainder : -remainder);
+	}
+
+	Interval squareRootOf(double x)
+	{
+		if (x == 0)
+			return Interval(0);
+		const double s = std::sqrt(x);
+		if (!std::isfinite(s) || x < exactLimit)
+		{
+			Interval result = widened(s);
+			return Interval(std::max(result.lower(), 0.0), result.upper());
+		}
+		return rounded(s, std::fma(-s, s, x));
+	}
+
+	//the hull of op applied to every pair of ends
+	Interval overEnds(const Interval& x, const Interval& y, Interval (*op)(double, double))
+	{
+		//the intervals of a double matrix have one end
+		if (x.lower() == x.upper() && y.lower() == y.upper())
+			return op(x.lower(), y.lower());
+		Interval result = op(x.lower(), y.lower());
+		result = hull(result, op(x.lower(), y.upper()));
+		result = hull(result, op(x.upper(), y.lower()));
+		return hull(result, op(x.upper(), y.upper()));
+	}
+}
+
+/*
+* a point interval
+
+* @param  x - the only value of the interval, not NaN
+*/
+Interval::Interval(double x) : lo{ x }, hi{ x }
+{
+	if (std::isnan(x))
+		throw std::invalid_argument("Invalid arguments");
+}
+
+/*
+* @param  lo, hi - the ends of the interval, lo <= hi
+*/
+Interval::Interval(double lo, double hi) : lo{ lo }, hi{ hi }
+{
+	if (!(lo <= hi))
+		throw std::invalid_argument("Invalid arguments");
+}
+
+/*
+* @return the value half way between the ends
+*/
+double Interval::midpoint() const
+{
+	if (this->lo == this->hi)
+		return this->lo;
+	return this->lo / 2 + this->hi / 2;
+}
+
+/*
+* @return an upper bound of hi - lo
+*/
+double Interval::width() const
+{
+	return sumOf(this->hi, -this->lo).upper();
+}
+
+/*
+* @param  x - a value
+
+* @return true if lo <= x <= hi
+*/
+bool Interval::contains(double x) const
+{
+	return this->lo <= x && x <= this->hi;
+}
+
+/*
+* operator overiding function for the output << operator
+	to print the interval in [lo, hi] format with every digit
+	needed to tell the ends apart
+
+* @param  a referrence to ostream
+* @param  a referrence to the interval
+
+* @return a referrence to ostream
+*/
+std::ostream& operator<<(std::ostream& out, const Interval& x)
+{
+	out << "[" << std::defaultfloat << std::setprecision(17) << x.lo << ", " << x.hi << "]";
+	return out;
+}
+
+/*
+* @return the interval of the negated values, exact
+*/
+Interval Interval::operator-() const
+{
+	return Interval(-this->hi, -this->lo);
+}
+
+Interval operator+(const Interval& lhs, const Interval& rhs)
+{
+	return Interval(sumOf(lhs.lo, rhs.lo).lo, sumOf(lhs.hi, rhs.hi).hi);
+}
+
+Interval operator-(const Interval& lhs, const Interval& rhs)
+{
+	return lhs + (-rhs);
+}
+
+Interval operator*(const Interval& lhs, const Interval& rhs)
+{
+	return overEnds(lhs, rhs, productOf);
+}
+
+/*
+* operator overiding function for the / operator
+
+* @param  lhs, rhs - the two intervals, rhs must not contain 0
+
+* @return an enclosure of every quotient
+*/
+Interval operator/(const Interval& lhs, const Interval& rhs)
+{
+	if (rhs.contains(0))
+		throw std::overflow_error("Divide by zero");
+	return overEnds(lhs, rhs, quotientOf);
+}
+
+/*
+* to square an interval, tighter than x * x when x contains 0
+
+* @param  x - a referrence to the interval
+
+* @return an enclosure of every x^2
+*/
+Interval square(const Interval& x)
+{
+	const Interval low = productOf(x.lo, x.lo), high = productOf(x.hi, x.hi);
+	if (x.contains(0))
+		return Interval(0, std::max(low.hi, high.hi));
+	return hull(low, high);
+}
+
+/*
+* to find the square root of an interval, negative values are ignored
+
+* @param  x - a referrence to the interval, its upper end must be >= 0
+
+* @return an enclosure of every square root
+*/
+Interval sqrt(const Interval& x)
+{
+	if (x.hi < 0)
+		throw std::invalid_argument("Invalid arguments");
+	return Interval(squareRootOf(std::max(x.lo, 0.0)).lo, squareRootOf(x.hi).hi);
+}
+
+/*
+* @param  x, y - two intervals
+
+* @return the smallest interval that contains both
+*/
+Interval hull(const Interval& x, const Interval& y)
+{
+	return Interval(std::min(x.lo, y.lo), std::max(x.hi, y.hi));
+}
+
+/*
+* to enclose the determinant of a double matrix
+
+* ad = p1 + e1 and bc = p2 + e2 exactly, with the products p rounded
+	to nearest and their errors e found with an FMA (TwoProduct). Then
+	ad - bc = (p1 - p2) + (e1 - e2), and p1 - p2 is usually exact
+	when ad and bc cancel, so the enclosure stays a few ulps of the
+	determinant wide instead of a few ulps of ad.
+
+* @param  m - a referrence to a 2x2 matrix
+
+* @return an enclosure of ad - bc
+*/
+Interval certifiedDeterminant(const Mat2x2& m)
+{
+	const double a = m[0], b = m[1], c = m[2], d = m[3];
+	const double p1 = a * d, p2 = b * c;
+	const bool exact1 = std::isfinite(p1) && (p1 == 0 ? a == 0 || d == 0 : std::abs(p1) >= exactLimit);
+	const bool exact2 = std::isfinite(p2) && (p2 == 0 ? b == 0 || c == 0 : std::abs(p2) >= exactLimit);
+	if (!exact1 || !exact2)
+		return productOf(a, d) - productOf(b, c);
+	const double e1 = std::fma(a, d, -p1), e2 = std::fma(b, c, -p2);
+	return (Interval(p1) - Interval(p2)) + (Interval(e1) - Interval(e2));
+}
+
+/*
+* @param  a, b, c, d - the intervals of the matrix
+	|a b|
+	|c d|
+*/
+IntervalMat2x2::IntervalMat2x2(const Interval& a, const Interval& b, const Interval& c, const Interval& d)
+	: a{ a }, b{ b }, c{ c }, d{ d }
+{
+}
+
+/*
+* a matrix of point intervals
+
+* @param  m - a referrence to a 2x2 matrix, without NaN
+*/
+IntervalMat2x2::IntervalMat2x2(const Mat2x2& m) : a{ m[0] }, b{ m[1] }, c{ m[2] }, d{ m[3] }
+{
+}
+
+/*
+* operator overiding function for the output << operator
+
+* @param  a referrence to ostream
+* @param  a referrence to the interval matrix
+
+* @return a referrence to ostream
+*/
+std::ostream& operator<<(std::ostream& out, const IntervalMat2x2& m)
+{
+	out << "|" << m.a << " " << m.b << "|" << std::endl;
+	out << "|" << m.c << " " << m.d << "|" << std::endl;
+	return out;
+}
+
+/*
+* to enclose the determinant, through certifiedDeterminant() when
+	every entry is a single value
+
+* @return an enclosure of ad - bc
+*/
+Interval IntervalMat2x2::determinant() const
+{
+	if (this->a.lower() == this->a.upper() && this->b.lower() == this->b.upper()
+		&& this->c.lower() == this->c.upper() && this->d.lower() == this->d.upper())
+		return certifiedDeterminant(Mat2x2(this->a.lower(), this->b.lower(), this->c.lower(), this->d.lower()));
+	return this->a * this->d - this->b * this->c;
+}
+
+/*
+* @return an enclosure of a + d
+*/
+Interval IntervalMat2x2::trace() const
+{
+	return this->a + this->d;
+}
+
+/*
+* to enclose the inverse of every matrix contained
+
+* unlike Mat2x2::inverse() there is no cut-off at exp(-6): any matrix
+	whose determinant is certainly not zero has an inverse, and the
+	width of the result shows how well it is determined
+
+* @return a copy of the enclosure of the inverse
+*/
+IntervalMat2x2 IntervalMat2x2::inverse() const
+{
+	const Interval det = this->determinant();
+	if (det.contains(0))
+		throw std::overflow_error("Divide by zero");
+	return IntervalMat2x2(this->d / det, -this->b / det, -this->c / det, this->a / det);
+}
+
+/*
+* @param  m - a referrence to a 2x2 matrix
+
+* @return true if every value of m lies in its interval
+*/
+bool IntervalMat2x2::contains(const Mat2x2& m) const
+{
+	return this->a.contains(m[0]) && this->b.contains(m[1]) && this->c.contains(m[2]) && this->d.contains(m[3]);
+}
+
+/*
+* @return the matrix of the midpoints
+*/
+Mat2x2 IntervalMat2x2::midpoint() const
+{
+	return Mat2x2(this->a.midpoint(), this->b.midpoint(), this->c.midpoint(), this->d.midpoint());
+}
+
+IntervalMat2x2 operator+(const IntervalMat2x2& lhs, const IntervalMat2x2& rhs)
+{
+	return IntervalMat2x2(lhs.a + rhs.a, lhs.b + rhs.b, lhs.c + rhs.c, lhs.d + rhs.d);
+}
+
+IntervalMat2x2 operator-(const IntervalMat2x2& lhs, const IntervalMat2x2& rhs)
+{
+	return IntervalMat2x2(lhs.a - rhs.a, lhs.b - rhs.b, lhs.c - rhs.c, lhs.d - rhs.d);
+}
+
+IntervalMat2x2 operator*(const IntervalMat2x2& lhs, const IntervalMat2x2& rhs)
+{
+	return IntervalMat2x2(lhs.a * rhs.a + lhs.b * rhs.c, lhs.a * rhs.b + lhs.b * rhs.d,
+		lhs.c * rhs.a + lhs.d * rhs.c, lhs.c * rhs.b + lhs.d * rhs.d);
+}
+
+/*
+* operator overiding function for the [] operator
+
+* @param  i - the index (0 to 3 for a, b, c, d) of the interval we are trying to access
+
+* @return a copy of the interval
+*/
+const Interval IntervalMat2x2::operator[](const int i) const
+{
+	if (i == 0)
+		return this->a;
+	if (i == 1)
+		return this->b;
+	if (i == 2)
+		return this->c;
+	if (i == 3)
+		return this->d;
+	throw std::invalid_argument("index out of bound");
+}
+
+/*
+* to enclose the eigenvalues of every matrix contained
+
+* the discriminant is taken as (a - d)^2 + 4bc, which equals
+	(a + d)^2 - 4(ad - bc) but does not cancel for symmetric matrices.
+	When its enclosure straddles 0 the eigenvalues may be real or
+	complex, and both possibilities are enclosed.
+
+* @param  m - a referrence to an interval matrix
+
+* @return the enclosures, ordered like eigenvalues(const Mat2x2&)
+*/
+IntervalEigenvalues eigenvalues(const IntervalMat2x2& m)
+{
+	const Interval half(0.5);
+	const Interval mid = (m.a + m.d) * half;
+	const Interval z = square(m.a - m.d) + Interval(4) * (m.b * m.c);
+	IntervalEigenvalues result;
+	if (z.lower() >= 0)
+	{
+		const Interval root = sqrt(z) * half;
+		result.re1 = mid + root;
+		result.re2 = mid - root;
+	}
+	else if (z.upper() < 0)
+	{
+		const Interval root = sqrt(-z) * half;
+		result.re1 = mid;
+		result.re2 = mid;
+		result.im1 = root;
+		result.im2 = -root;
+	}
+	else
+	{
+		const Interval real = sqrt(Interval(0, z.upper())) * half;
+		const Interval imaginary = sqrt(Interval(0, -z.lower())) * half;
+		result.re1 = mid + real;
+		result.re2 = mid - real;
+		result.im1 = imaginary;
+		result.im2 = -imaginary;
+	}
+	return result;
+}
@@ -0,0 +1,92 @@
+#ifndef INTERVAL_H
+#define INTERVAL_H
+#include<iostream>
+#include"Mat2x2.h"
+
+/*
+* a closed interval [lo, hi] of doubles that is guaranteed to contain
+	the exact real result of every operation applied to it
+
+* results are rounded outwards with error-free transformations: the
+	rounding error of a sum (TwoSum) or of a product, quotient or square
+	root (FMA) tells on which side of the rounded value the exact value
+	lies, so most results are only one ulp wide, not two. When an error
+	term could underflow both ends are widened by one ulp instead.
+*/
+class Interval
+{
+private:
+	double lo, hi;
+public:
+	Interval();
+	Interval(double);
+	Interval(double, double);
+
+	double lower() const;
+	double upper() const;
+	double midpoint() const;
+	double width() const;
+	bool contains(double) const;
+
+	friend std::ostream& operator<<(std::ostream&, const Interval&);
+
+	Interval operator-() const;
+	friend Interval operator+(const Interval&, const Interval&);
+	friend Interval operator-(const Interval&, const Interval&);
+	friend Interval operator*(const Interval&, const Interval&);
+	friend Interval operator/(const Interval&, const Interval&);
+
+	friend Interval square(const Interval&);
+	friend Interval sqrt(const Interval&);
+	friend Interval hull(const Interval&, const Interval&);
+};
+inline Interval::Interval() : lo{ 0 }, hi{ 0 } {}
+inline double Interval::lower() const { return lo; }
+inline double Interval::upper() const { return hi; }
+
+/*
+* enclosures of the two eigenvalues lambda1 = re1 + i im1 and
+	lambda2 = re2 + i im2, in the order of Eigenvalues
+*/
+struct IntervalEigenvalues
+{
+	Interval re1, im1;
+	Interval re2, im2;
+};
+
+/*
+* a 2x2 matrix of intervals, every operation returns a rigorous
+	enclosure of the exact result for every matrix the operands contain
+*/
+class IntervalMat2x2
+{
+private:
+	Interval a, b, c, d;
+public:
+	IntervalMat2x2();
+	IntervalMat2x2(const Interval&, const Interval&, const Interval&, const Interval&);
+	explicit IntervalMat2x2(const Mat2x2&);
+
+	friend std::ostream& operator<<(std::ostream&, const IntervalMat2x2&);
+
+	Interval determinant() const;
+	Interval trace() const;
+	IntervalMat2x2 inverse() const;
+	bool contains(const Mat2x2&) const;
+	Mat2x2 midpoint() const;
+
+	//Simple assignments
+	friend IntervalMat2x2 operator+(const IntervalMat2x2&, const IntervalMat2x2&);
+	friend IntervalMat2x2 operator-(const IntervalMat2x2&, const IntervalMat2x2&);
+	friend IntervalMat2x2 operator*(const IntervalMat2x2&, const IntervalMat2x2&);
+
+	//Subscript
+	const Interval operator[](const int) const;
+
+	friend IntervalEigenvalues eigenvalues(const IntervalMat2x2&);
+};
+inline IntervalMat2x2::IntervalMat2x2() {}
+
+//the exact ad - bc of a double matrix, at most a few ulps wide however much ad and bc cancel
+Interval certifiedDeterminant(const Mat2x2&);
+#endif
@@ -1,7 +1,10 @@
 #include "Mat2x2.h"
+#include "Compensated.h"
 #include<iostream>
 #include<iomanip>
 
+std::atomic<Arithmetic> Mat2x2::policy{ Arithmetic::Naive };
+
 /*
 * Parameterised constructor initializes the 4 values in 
 	the 2x2 matrix
@@ -53,9 +56,45 @@ Mat2x2& Mat2x2::operator=(const Mat2x2& m)
 */
 const double Mat2x2::determinant() const
 {
+	return this->determinant(policy.load(std::memory_order_relaxed));
+}
+
+/*
+* to find the determinant of the matrix with the given arithmetic
+	(ad - bc)
+
+* @param  arithmetic - Naive or Compensated
+
+* @return a double value of the determinant calculated
+*/
+double Mat2x2::determinant(Arithmetic arithmetic) const
+{
+	if (arithmetic == Arithmetic::Compensated)
+		return compensatedDot(a, d, -b, c);
 	return ((a*d) - (b*c));
 }
 
+/*
+* @return the arithmetic determinant(), inverse() and the
+	matrix product currently use
+*/
+Arithmetic Mat2x2::arithmetic()
+{
+	//nothing else is published with the policy, relaxed is enough
+	return policy.load(std::memory_order_relaxed);
+}
+
+/*
+* to choose the arithmetic of determinant(), inverse() and the
+	matrix product for every matrix
+
+* @param  arithmetic - Naive (the default) or Compensated
+*/
+void Mat2x2::setArithmetic(Arithmetic arithmetic)
+{
+	policy.store(arithmetic, std::memory_order_relaxed);
+}
+
 /*
 * to find the trace of the matrix
 (a + d)
@@ -89,7 +128,8 @@ bool Mat2x2::isSymmetric() const
 */
 bool Mat2x2::isSimilar(Mat2x2& m) const
 {
-	if (this->determinant() == m.determinant() && this->trace() == m.trace())
+	const Arithmetic arithmetic = policy.load(std::memory_order_relaxed);
+	if (this->determinant(arithmetic) == m.determinant(arithmetic) && this->trace() == m.trace())
 		return true;
 	return false;
 }
@@ -114,15 +154,28 @@ Mat2x2 Mat2x2::transpose()
 */
 Mat2x2 Mat2x2::inverse()
 {
-	if (this->determinant() != 0)
+	return this->inverse(policy.load(std::memory_order_relaxed));
+}
+
+/*
+* to give the inverse of a matrix with the given arithmetic
+
+* @param  arithmetic - Naive or Compensated
+
+* @return a copy of the inverse of the current matrix
+*/
+Mat2x2 Mat2x2::inverse(Arithmetic arithmetic)
+{
+	const double det = this->determinant(arithmetic);
+	if (det != 0)
 	{
-		if (abs(this->determinant()) <= exp(-6))
+		if (abs(det) <= exp(-6))
 			throw std::overflow_error("Inverse undefined");
 		Mat2x2 temp = *this;
-		temp.a = this->d * (1 / this->determinant());
-		temp.b = -this->b * (1 / this->determinant());
-		temp.c = -this->c * (1 / this->determinant());
-		temp.d = this->a * (1 / this->determinant());
+		temp.a = this->d * (1 / det);
+		temp.b = -this->b * (1 / det);
+		temp.c = -this->c * (1 / det);
+		temp.d = this->a * (1 / det);
 		return temp;
 	}
 	else
@@ -177,12 +230,37 @@ which the operation has to be executed
 after the execution of the operation
 */
 Mat2x2& Mat2x2::operator*=(Mat2x2& m)	
+{
+	return this->multiplyBy(m, policy.load(std::memory_order_relaxed));
+}
+
+/*
+* to multiply the current matrix by another with the given arithmetic
+
+* @param  a referrence to a 2x2 matrix with
+which the operation has to be executed
+* @param  arithmetic - Naive or Compensated
+
+* @return a referrence to the current matrix
+after the execution of the operation
+*/
+Mat2x2& Mat2x2::multiplyBy(Mat2x2& m, Arithmetic arithmetic)
 {
 	Mat2x2 temp = *this;
-	temp.a = this->a * m.a + this->b * m.c;
-	temp.b = this->a * m.b + this->b * m.d;
-	temp.c = this->c * m.a + this->d * m.c;
-	temp.d = this->c * m.b + this->d * m.d;
+	if (arithmetic == Arithmetic::Compensated)
+	{
+		temp.a = compensatedDot(this->a, m.a, this->b, m.c);
+		temp.b = compensatedDot(this->a, m.b, this->b, m.d);
+		temp.c = compensatedDot(this->c, m.a, this->d, m.c);
+		temp.d = compensatedDot(this->c, m.b, this->d, m.d);
+	}
+	else
+	{
+		temp.a = this->a * m.a + this->b * m.c;
+		temp.b = this->a * m.b + this->b * m.d;
+		temp.c = this->c * m.a + this->d * m.c;
+		temp.d = this->c * m.b + this->d * m.d;
+	}
 	*this = temp;
 	return *this;
 }
@@ -198,7 +276,9 @@ after the execution of the operation
 */
 Mat2x2& Mat2x2::operator/=(Mat2x2& m)
 {
-	return *this *= m.inverse();
+	const Arithmetic arithmetic = policy.load(std::memory_order_relaxed);
+	Mat2x2 inverse = m.inverse(arithmetic);
+	return this->multiplyBy(inverse, arithmetic);
 }
 
 /*
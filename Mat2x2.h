@@ -1,12 +1,27 @@
 #ifndef MAT2X2_H
 #define MAT2X2_H
+#include<atomic>
 #include<iostream>
 #include<vector>
 
+/*
+* how determinant(), inverse() and the matrix product are evaluated
+	Naive - a * d - b * c as written, fastest
+	Compensated - Kahan's FMA algorithm, within 2 ulps even when the
+		two products cancel, so inverse() no longer throws for
+		determinants that only rounded to 0
+*/
+enum class Arithmetic
+{
+	Naive,
+	Compensated
+};
+
 class Mat2x2
 {
 private:
 	double a, b, c, d;
+	static std::atomic<Arithmetic> policy;
 	int numberOfDigits() const;
 	double maximum() const;
 public:
@@ -20,17 +35,20 @@ public:
 	friend std::istream& operator>>(std::istream&, Mat2x2&);
 
 	const double determinant() const;
+	double determinant(Arithmetic) const;
 	const double trace() const;
 	bool isSymmetric() const;
 	bool isSimilar(Mat2x2& ) const;
 	Mat2x2 transpose();
 	Mat2x2 inverse();
+	Mat2x2 inverse(Arithmetic);
 
 	//Compound assignments
 	Mat2x2& operator+=(Mat2x2&);
 	Mat2x2& operator-=(Mat2x2&);
 	Mat2x2& operator*=(Mat2x2&);
 	Mat2x2& operator/=(Mat2x2&);
+	Mat2x2& multiplyBy(Mat2x2&, Arithmetic);
 	Mat2x2& operator+=(const double);
 	Mat2x2& operator-=(const double);
 	Mat2x2& operator*=(const double);
@@ -68,9 +86,26 @@ public:
 	double& operator[](const int);
 	const double operator[](const int) const;
 
+	//The values a, b, c, d in that order, for kernels and modules outside the class
+	double* data();
+	const double* data() const;
+
 	std::vector<double> operator()(int = 0) const;
 
+	/*
+	* the process-wide arithmetic policy of determinant(), inverse() and
+		operator*=. It may change while other threads run: every call
+		reads it once, so it uses one arithmetic throughout, but calls
+		already running may finish with the old one. Code that needs a
+		fixed arithmetic passes it per call to determinant(Arithmetic),
+		inverse(Arithmetic), multiplyBy() or kernels(IsaLevel, Arithmetic).
+	*/
+	static Arithmetic arithmetic();
+	static void setArithmetic(Arithmetic);
+
 	friend void printEigenvalues(std::vector<double>& v, int i);
 };
 inline Mat2x2::Mat2x2() : a{ 0 }, b{ 0 }, c{ 0 }, d{ 0 } {}
+inline double* Mat2x2::data() { return &this->a; }
+inline const double* Mat2x2::data() const { return &this->a; }
 #endif
\ No newline at end of file
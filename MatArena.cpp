@@ -0,0 +1,121 @@
+#include "MatArena.h"
+
+/*
+* constructor reserves the initial block that every request starts from
+
+* @param  initialBytes - the size of the block that is reused between requests
+* @param  upstream - the resource used once the initial block is exhausted
+*/
+MatArena::MatArena(std::size_t initialBytes, std::pmr::memory_resource* upstream)
+	: buffer(initialBytes), arena(buffer.data(), buffer.size(), upstream)
+{
+}
+
+/*
+* @return the memory resource to pass to the batch APIs
+*/
+std::pmr::memory_resource* MatArena::resource()
+{
+	return &this->arena;
+}
+
+/*
+* to create an empty batch of matrices backed by the arena
+
+* @param  capacity - the number of matrices to reserve room for, reserving
+	up front avoids leaving abandoned blocks behind when the batch grows
+
+* @return the batch
+*/
+Mat2x2Batch MatArena::batch(std::size_t capacity)
+{
+	Mat2x2Batch result(&this->arena);
+	result.reserve(capacity);
+	return result;
+}
+
+/*
+* to create an empty batch of eigenvalues backed by the arena
+
+* @param  capacity - the number of results to reserve room for
+
+* @return the batch
+*/
+EigenvaluesBatch MatArena::eigenvaluesBatch(std::size_t capacity)
+{
+	EigenvaluesBatch result(&this->arena);
+	result.reserve(capacity);
+	return result;
+}
+
+/*
+* to free everything carved from the arena at once. Batches created from
+	the arena must not be used afterwards.
+*/
+void MatArena::release()
+{
+	this->arena.release();
+}
+
+/*
+* constructor
+
+* @param  upstream - the resource that actually serves the requests
+*/
+CountingResource::CountingResource(std::pmr::memory_resource* upstream)
+	: upstream{ upstream }, allocationCount{ 0 }, deallocationCount{ 0 }, bytes{ 0 }
+{
+}
+
+void* CountingResource::do_allocate(std::size_t size, std::size_t alignment)
+{
+	void* p = this->upstream->allocate(size, alignment);
+	this->allocationCount++;
+	this->bytes += size;
+	return p;
+}
+
+void CountingResource::do_deallocate(void* p, std::size_t size, std::size_t alignment)
+{
+	this->upstream->deallocate(p, size, alignment);
+	this->deallocationCount++;
+}
+
+bool CountingResource::do_is_equal(const std::pmr::memory_resource& other) const noexcept
+{
+	return this == &other;
+}
+
+/*
+* @return the number of allocations since construction or the last reset()
+*/
+std::size_t CountingResource::allocations() const
+{
+	return this->allocationCount;
+}
+
+/*
+* @return the number of deallocations since construction or the last reset()
+*/
+std::size_t CountingResource::deallocations() const
+{
+	return this->deallocationCount;
+}
+
+/*
+* @return the number of bytes allocated since construction or the last reset()
+*/
+std::size_t CountingResource::bytesAllocated() const
+{
+	return this->bytes;
+}
+
+/*
+* to set all the counters back to zero
+*/
+void CountingResource::reset()
+{
+	this->allocationCount = 0;
+	this->deallocationCount = 0;
+	this->bytes = 0;
+}
@@ -0,0 +1,60 @@
+#ifndef MATARENA_H
+#define MATARENA_H
+#include<cstddef>
+#include<memory_resource>
+#include<vector>
+#include"Mat2x2.h"
+#include"Decomposition.h"
+
+//a batch of matrices whose storage comes from a memory resource
+typedef std::pmr::vector<Mat2x2> Mat2x2Batch;
+typedef std::pmr::vector<Eigenvalues> EigenvaluesBatch;
+
+/*
+* per-request scratch memory for batches of matrices and their results
+
+* allocations are carved out of one block with a monotonic buffer and
+	are never freed one by one. release() hands everything back in one
+	shot and keeps the initial block, so a request that fits in it
+	does not touch the heap at all.
+*/
+class MatArena
+{
+private:
+	std::vector<unsigned char> buffer;
+	std::pmr::monotonic_buffer_resource arena;
+public:
+	explicit MatArena(std::size_t = 64 * 1024, std::pmr::memory_resource* = std::pmr::get_default_resource());
+	MatArena(const MatArena&) = delete;
+	MatArena& operator=(const MatArena&) = delete;
+
+	std::pmr::memory_resource* resource();
+	Mat2x2Batch batch(std::size_t = 0);
+	EigenvaluesBatch eigenvaluesBatch(std::size_t = 0);
+	void release();
+};
+
+/*
+* a memory resource that forwards to another one and counts the traffic,
+	used to measure how often a code path reaches the allocator
+*/
+class CountingResource : public std::pmr::memory_resource
+{
+private:
+	std::pmr::memory_resource* upstream;
+	std::size_t allocationCount;
+	std::size_t deallocationCount;
+	std::size_t bytes;
+protected:
+	void* do_allocate(std::size_t, std::size_t) override;
+	void do_deallocate(void*, std::size_t, std::size_t) override;
+	bool do_is_equal(const std::pmr::memory_resource&) const noexcept override;
+public:
+	explicit CountingResource(std::pmr::memory_resource* = std::pmr::get_default_resource());
+
+	std::size_t allocations() const;
+	std::size_t deallocations() const;
+	std::size_t bytesAllocated() const;
+	void reset();
+};
+#endif
@@ -0,0 +1,55 @@
+#ifndef MATQUEUE_H
+#define MATQUEUE_H
+#include<cstddef>
+#include"Mat2x2.h"
+#include"SpscQueue.h"
+#include"MpmcQueue.h"
+
+/*
+* a fixed-size group of matrices moved through a queue as one value,
+	so the cost of claiming a slot is shared by many matrices
+*/
+struct MatBlock
+{
+	static const std::size_t capacity = 16;
+
+	std::size_t count;
+	Mat2x2 m[capacity];
+};
+
+//lock-free rings specialised for single matrices and blocks of them
+typedef SpscQueue<Mat2x2> MatSpscQueue;
+typedef MpmcQueue<Mat2x2> MatMpmcQueue;
+typedef SpscQueue<MatBlock> MatBlockSpscQueue;
+typedef MpmcQueue<MatBlock> MatBlockMpmcQueue;
+
+/*
+* to wait until a value fits into the queue, only for types with a
+	matching tryPush so it cannot capture other push calls
+
+* @param  queue - a referrence to any of the queues above
+* @param  value - the value to add
+*/
+template<typename Queue, typename T>
+auto push(Queue& queue, const T& value) -> decltype(queue.tryPush(value), void())
+{
+	Backoff backoff;
+	while (!queue.tryPush(value))
+		backoff.pause();
+}
+
+/*
+* to wait until a value can be taken from the queue, only for types
+	with a matching tryPop
+
+* @param  queue - a referrence to any of the queues above
+* @param  value - receives the removed value
+*/
+template<typename Queue, typename T>
+auto pop(Queue& queue, T& value) -> decltype(queue.tryPop(value), void())
+{
+	Backoff backoff;
+	while (!queue.tryPop(value))
+		backoff.pause();
+}
+#endif
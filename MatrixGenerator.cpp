@@ -0,0 +1,161 @@
+#include "MatrixGenerator.h"
+#include<algorithm>
+#include<cmath>
+#include<thread>
+
+namespace
+{
+	/*
+	* SplitMix64, a small generator whose output is fully specified,
+		unlike the std distributions, so datasets are reproducible
+		across compilers and standard libraries
+	*/
+	class SplitMix64
+	{
+	private:
+		std::uint64_t state;
+	public:
+		explicit SplitMix64(std::uint64_t seed) : state{ seed } {}
+
+		std::uint64_t next()
+		{
+			std::uint64_t z = (this->state += 0x9E3779B97F4A7C15ull);
+			z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+			z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+			return z ^ (z >> 31);
+		}
+
+		//uniform in [0, 1)
+		double unit()
+		{
+			return (this->next() >> 11) * (1.0 / 9007199254740992.0);
+		}
+
+		//uniform in [lo, hi)
+		double uniform(double lo, double hi)
+		{
+			return lo + (hi - lo) * this->unit();
+		}
+
+		//uniform integer in [lo, hi]
+		int integer(int lo, int hi)
+		{
+			return lo + static_cast<int>(this->next() % static_cast<std::uint64_t>(hi - lo + 1));
+		}
+	};
+
+	Mat2x2 sample(Distribution distribution, SplitMix64& random)
+	{
+		switch (distribution)
+		{
+		case Distribution::Symmetric:
+		{
+			double b = random.uniform(-1, 1);
+			return Mat2x2(random.uniform(-1, 1), b, b, random.uniform(-1, 1));
+		}
+		case Distribution::Singular:
+		case Distribution::NearSingular:
+		{
+			double a = random.uniform(-1, 1);
+			double b = random.uniform(-1, 1);
+			//scaling by a power of two is exact, so a * d - b * c is exactly zero
+			double k = std::ldexp(1.0, random.integer(-4, 4));
+			double d = k * b;
+			if (distribution == Distribution::NearSingular)
+				d += d * 1e-10 * random.uniform(0.5, 1);
+			return Mat2x2(a, b, k * a, d);
+		}
+		case Distribution::ComplexEigenvalues:
+		{
+			//(a - d)^2 + 4bc < 0 when bc < -(a - d)^2 / 4
+			double a = random.uniform(-1, 1);
+			double d = random.uniform(-1, 1);
+			double b = random.uniform(0.5, 1);
+			double c = -((a - d) * (a - d) / (4 * b) + random.uniform(0.01, 1));
+			if (random.next() & 1)
+				return Mat2x2(a, -b, -c, d);
+			return Mat2x2(a, b, c, d);
+		}
+		case Distribution::HugeDynamicRange:
+		{
+			double v[4];
+			for (double& x : v)
+			{
+				x = std::ldexp(random.uniform(1, 2), random.integer(-500, 500));
+				if (random.next() & 1)
+					x = -x;
+			}
+			return Mat2x2(v[0], v[1], v[2], v[3]);
+		}
+		case Distribution::Uniform:
+		default:
+			return Mat2x2(random.uniform(-1, 1), random.uniform(-1, 1), random.uniform(-1, 1), random.uniform(-1, 1));
+		}
+	}
+}
+
+/*
+* to fill one block of a dataset
+
+* @param  distribution - the kind of matrices to generate
+* @param  out - pointer to the first matrix of the block
+* @param  count - the number of matrices, at most generatorBlockSize
+* @param  seed - the seed of the whole dataset
+* @param  block - the index of the block within the dataset
+*/
+void generateBlock(Distribution distribution, Mat2x2* out, std::size_t count, std::uint64_t seed, std::size_t block)
+{
+	SplitMix64 mixer(seed ^ (0xD1B54A32D192ED03ull * (block + 1)));
+	SplitMix64 random(mixer.next());
+	for (std::size_t i = 0; i < count; i++)
+		out[i] = sample(distribution, random);
+}
+
+/*
+* to fill an array with random matrices, in parallel
+
+* @param  distribution - the kind of matrices to generate
+* @param  out - pointer to the first matrix
+* @param  n - the number of matrices
+* @param  seed - the seed, the same seed always gives the same matrices
+* @param  threads - the number of threads to use, 0 for one per core
+*/
+void generate(Distribution distribution, Mat2x2* out, std::size_t n, std::uint64_t seed, unsigned threads)
+{
+	const std::size_t blocks = (n + generatorBlockSize - 1) / generatorBlockSize;
+	if (threads == 0)
+		threads = std::max(1u, std::thread::hardware_concurrency());
+	threads = static_cast<unsigned>(std::min<std::size_t>(threads, std::max<std::size_t>(blocks, 1)));
+
+	auto work = [=](unsigned t)
+	{
+		for (std::size_t block = t; block < blocks; block += threads)
+		{
+			const std::size_t first = block * generatorBlockSize;
+			generateBlock(distribution, out + first, std::min(generatorBlockSize, n - first), seed, block);
+		}
+	};
+	std::vector<std::thread> pool;
+	for (unsigned t = 1; t < threads; t++)
+		pool.emplace_back(work, t);
+	work(0);
+	for (std::thread& thread : pool)
+		thread.join();
+}
+
+/*
+* to create a vector of random matrices, in parallel
+
+* @param  distribution - the kind of matrices to generate
+* @param  n - the number of matrices
+* @param  seed - the seed, the same seed always gives the same matrices
+* @param  threads - the number of threads to use, 0 for one per core
+
+* @return the vector of matrices
+*/
+std::vector<Mat2x2> generate(Distribution distribution, std::size_t n, std::uint64_t seed, unsigned threads)
+{
+	std::vector<Mat2x2> result(n);
+	generate(distribution, result.data(), n, seed, threads);
+	return result;
+}
@@ -0,0 +1,28 @@
+#ifndef MATRIXGENERATOR_H
+#define MATRIXGENERATOR_H
+#include<cstddef>
+#include<cstdint>
+#include<vector>
+#include"Mat2x2.h"
+
+enum class Distribution
+{
+	Uniform,			//every value uniform in [-1, 1)
+	Symmetric,			//uniform with b == c
+	Singular,			//second row an exact power-of-two multiple of the first, det == 0
+	NearSingular,		//singular with a relative perturbation of about 1e-10 on d
+	ComplexEigenvalues,	//trace^2 - 4 det < 0
+	HugeDynamicRange	//values of random sign with exponents in [-500, 500]
+};
+
+/*
+* matrices are generated in blocks of this many, each block seeded from
+	the seed and the block index alone, so the same seed gives the same
+	dataset whatever the number of threads
+*/
+const std::size_t generatorBlockSize = 4096;
+
+void generateBlock(Distribution, Mat2x2*, std::size_t, std::uint64_t, std::size_t);
+void generate(Distribution, Mat2x2*, std::size_t, std::uint64_t, unsigned = 0);
+std::vector<Mat2x2> generate(Distribution, std::size_t, std::uint64_t, unsigned = 0);
+#endif
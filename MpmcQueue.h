@@ -0,0 +1,131 @@
+#ifndef MPMCQUEUE_H
+#define MPMCQUEUE_H
+#include<atomic>
+#include<cstddef>
+#include<stdexcept>
+#include<vector>
+#include"SpscQueue.h"
+
+/*
+* a bounded lock-free queue for any number of producer and consumer
+	threads (D. Vyukov's sequenced ring)
+
+* every slot carries a sequence number that says whether it is ready
+	to be written or read in the current lap of the ring. A producer or
+	consumer claims a position with one CAS on the tail or head and then
+	owns the slot, so the only shared writes are that CAS and the
+	slot's sequence. Slots are padded to a cache line so neighbouring
+	positions never share one.
+*/
+template<typename T>
+class MpmcQueue
+{
+private:
+	struct alignas(cacheLineSize) Slot
+	{
+		std::atomic<std::size_t> sequence;
+		T value;
+	};
+
+	std::vector<Slot> slots;
+	std::size_t mask;
+	alignas(cacheLineSize) std::atomic<std::size_t> tail;
+	alignas(cacheLineSize) std::atomic<std::size_t> head;
+public:
+	explicit MpmcQueue(std::size_t);
+	MpmcQueue(const MpmcQueue&) = delete;
+	MpmcQueue& operator=(const MpmcQueue&) = delete;
+
+	bool tryPush(const T&);
+	bool tryPop(T&);
+	std::size_t capacity() const;
+};
+
+/*
+* constructor
+
+* @param  capacity - the number of slots, must be a power of two
+*/
+template<typename T>
+MpmcQueue<T>::MpmcQueue(std::size_t capacity)
+	: slots(capacity), mask{ capacity - 1 }, tail{ 0 }, head{ 0 }
+{
+	if (capacity == 0 || (capacity & (capacity - 1)) != 0)
+		throw std::invalid_argument("capacity must be a power of two");
+	for (std::size_t i = 0; i < capacity; i++)
+		this->slots[i].sequence.store(i, std::memory_order_relaxed);
+}
+
+/*
+* to add a value at the back, from any thread
+
+* @param  value - the value to add
+
+* @return false if the queue is full
+*/
+template<typename T>
+bool MpmcQueue<T>::tryPush(const T& value)
+{
+	std::size_t pos = this->tail.load(std::memory_order_relaxed);
+	for (;;)
+	{
+		Slot& slot = this->slots[pos & this->mask];
+		const std::size_t seq = slot.sequence.load(std::memory_order_acquire);
+		const std::ptrdiff_t diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos);
+		if (diff == 0)
+		{
+			if (this->tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+			{
+				slot.value = value;
+				slot.sequence.store(pos + 1, std::memory_order_release);
+				return true;
+			}
+		}
+		else if (diff < 0)
+			return false;
+		else
+			pos = this->tail.load(std::memory_order_relaxed);
+	}
+}
+
+/*
+* to remove the value at the front, from any thread
+
+* @param  value - receives the removed value
+
+* @return false if the queue is empty
+*/
+template<typename T>
+bool MpmcQueue<T>::tryPop(T& value)
+{
+	std::size_t pos = this->head.load(std::memory_order_relaxed);
+	for (;;)
+	{
+		Slot& slot = this->slots[pos & this->mask];
+		const std::size_t seq = slot.sequence.load(std::memory_order_acquire);
+		const std::ptrdiff_t diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos + 1);
+		if (diff == 0)
+		{
+			if (this->head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+			{
+				value = slot.value;
+				slot.sequence.store(pos + this->mask + 1, std::memory_order_release);
+				return true;
+			}
+		}
+		else if (diff < 0)
+			return false;
+		else
+			pos = this->head.load(std::memory_order_relaxed);
+	}
+}
+
+/*
+* @return the number of slots
+*/
+template<typename T>
+std::size_t MpmcQueue<T>::capacity() const
+{
+	return this->slots.size();
+}
+#endif
@@ -0,0 +1,332 @@
+#include "Pipeline.h"
+#include "SpscQueue.h"
+#include<algorithm>
+#include<atomic>
+#include<exception>
+#include<memory>
+#include<mutex>
+#include<stdexcept>
+#include<thread>
+
+namespace
+{
+	typedef SpscQueue<Pipeline::Chunk*> ChunkQueue;
+
+	std::size_t powerOfTwoAtLeast(std::size_t n)
+	{
+		std::size_t p = 1;
+		while (p < n)
+			p *= 2;
+		return p;
+	}
+
+	/*
+	* the state shared by the threads of one run, the first exception
+		thrown by a source, stage or sink stops every thread
+	*/
+	struct RunState
+	{
+		std::atomic<bool> failed{ false };
+		std::mutex errorLock;
+		std::exception_ptr error;
+
+		void fail()
+		{
+			std::lock_guard<std::mutex> lock(this->errorLock);
+			if (!this->error)
+				this->error = std::current_exception();
+			this->failed.store(true);
+		}
+	};
+
+	//waits for room in the queue, false if the run failed meanwhile
+	bool push(ChunkQueue& queue, Pipeline::Chunk* chunk, RunState& state)
+	{
+		Backoff backoff;
+		while (!queue.tryPush(chunk))
+		{
+			if (state.failed.load(std::memory_order_relaxed))
+				return false;
+			backoff.pause();
+		}
+		return true;
+	}
+
+	//waits for a chunk, false if the run failed meanwhile
+	bool pop(ChunkQueue& queue, Pipeline::Chunk*& chunk, RunState& state)
+	{
+		Backoff backoff;
+		while (!queue.tryPop(chunk))
+		{
+			if (state.failed.load(std::memory_order_relaxed))
+				return false;
+			backoff.pause();
+		}
+		return true;
+	}
+}
+
+/*
+* constructor, allocates the matrices once, the chunk starts empty
+
+* @param  capacity - the most matrices the chunk can hold
+*/
+Pipeline::Chunk::Chunk(std::size_t capacity) : storage(capacity), count{ 0 }
+{
+}
+
+/*
+* @return the number of valid matrices
+*/
+std::size_t Pipeline::Chunk::size() const
+{
+	return this->count;
+}
+
+/*
+* @return the most matrices the chunk can hold
+*/
+std::size_t Pipeline::Chunk::capacity() const
+{
+	return this->storage.size();
+}
+
+/*
+* @return the first matrix of the buffer
+*/
+Mat2x2* Pipeline::Chunk::data()
+{
+	return this->storage.data();
+}
+
+const Mat2x2* Pipeline::Chunk::data() const
+{
+	return this->storage.data();
+}
+
+/*
+* @return the first valid matrix
+*/
+Mat2x2* Pipeline::Chunk::begin()
+{
+	return this->storage.data();
+}
+
+/*
+* @return one past the last valid matrix
+*/
+Mat2x2* Pipeline::Chunk::end()
+{
+	return this->storage.data() + this->count;
+}
+
+const Mat2x2* Pipeline::Chunk::begin() const
+{
+	return this->storage.data();
+}
+
+const Mat2x2* Pipeline::Chunk::end() const
+{
+	return this->storage.data() + this->count;
+}
+
+/*
+* @return a referrence to the i-th matrix
+*/
+Mat2x2& Pipeline::Chunk::operator[](std::size_t i)
+{
+	return this->storage[i];
+}
+
+const Mat2x2& Pipeline::Chunk::operator[](std::size_t i) const
+{
+	return this->storage[i];
+}
+
+/*
+* to change the number of valid matrices without touching any of them
+
+* @param  n - the new size, at most capacity()
+*/
+void Pipeline::Chunk::resize(std::size_t n)
+{
+	if (n > this->storage.size())
+		throw std::invalid_argument("Invalid arguments");
+	this->count = n;
+}
+
+/*
+* to remove a range of matrices, the ones after it move forward
+
+* @param  first - the first matrix removed
+* @param  last - one past the last matrix removed
+
+* @return where the first matrix after the range now is
+*/
+Mat2x2* Pipeline::Chunk::erase(Mat2x2* first, Mat2x2* last)
+{
+	Mat2x2* const moved = std::copy(last, this->end(), first);
+	this->count = static_cast<std::size_t>(moved - this->begin());
+	return first;
+}
+
+/*
+* constructor
+
+* @param  chunkSize - the number of matrices handed from stage to stage at once
+* @param  queueDepth - the number of chunks that may wait between two stages
+*/
+Pipeline::Pipeline(std::size_t chunkSize, std::size_t queueDepth)
+	: chunkSize{ chunkSize }, queueDepth{ queueDepth }
+{
+	if (chunkSize == 0 || queueDepth == 0)
+		throw std::invalid_argument("Invalid arguments");
+}
+
+/*
+* to append a stage that works on whole chunks
+
+* @param  stage - the function applied to every chunk
+
+* @return a referrence to the pipeline
+*/
+Pipeline& Pipeline::then(Stage stage)
+{
+	this->stages.push_back(stage);
+	return *this;
+}
+
+/*
+* to append a stage that transforms every matrix
+
+* @param  f - the function applied to every matrix
+
+* @return a referrence to the pipeline
+*/
+Pipeline& Pipeline::map(std::function<void(Mat2x2&)> f)
+{
+	return this->then([f](Chunk& chunk)
+	{
+		for (Mat2x2& m : chunk)
+			f(m);
+	});
+}
+
+/*
+* to append a stage that drops the matrices a predicate rejects
+
+* @param  keep - returns true for the matrices that are passed on
+
+* @return a referrence to the pipeline
+*/
+Pipeline& Pipeline::filter(std::function<bool(const Mat2x2&)> keep)
+{
+	return this->then([keep](Chunk& chunk)
+	{
+		chunk.erase(std::remove_if(chunk.begin(), chunk.end(),
+			[&keep](const Mat2x2& m) { return !keep(m); }), chunk.end());
+	});
+}
+
+/*
+* @return the number of chunks in the pool, peak memory is this
+	many times chunkSize matrices
+*/
+std::size_t Pipeline::chunks() const
+{
+	//every queue full, plus the chunk each thread is working on
+	return this->queueDepth * (this->stages.size() + 1) + this->stages.size() + 2;
+}
+
+/*
+* to stream the whole input through the stages into the sink.
+	Returns when the source is exhausted and the sink has seen every
+	chunk; an exception thrown by any part stops the run and is
+	rethrown here.
+
+* @param  source - produces the input
+* @param  sink - consumes the output, in input order
+*/
+void Pipeline::run(Source source, Sink sink)
+{
+	const std::size_t poolSize = this->chunks();
+	std::vector<Chunk> pool(poolSize, Chunk(this->chunkSize));
+	ChunkQueue free(powerOfTwoAtLeast(poolSize));
+	for (Chunk& chunk : pool)
+		free.tryPush(&chunk);
+	std::vector<std::unique_ptr<ChunkQueue>> links;
+	for (std::size_t i = 0; i <= this->stages.size(); i++)
+		links.emplace_back(new ChunkQueue(powerOfTwoAtLeast(this->queueDepth)));
+
+	RunState state;
+	std::vector<std::thread> threads;
+
+	//a null chunk marks the end of the input
+	threads.emplace_back([&]()
+	{
+		try
+		{
+			Chunk* chunk;
+			while (pop(free, chunk, state))
+			{
+				const std::size_t n = source(chunk->data(), this->chunkSize);
+				if (n > this->chunkSize)
+					throw std::logic_error("the source returned more matrices than asked for");
+				if (n == 0)
+				{
+					push(*links[0], nullptr, state);
+					return;
+				}
+				chunk->resize(n);
+				if (!push(*links[0], chunk, state))
+					return;
+			}
+		}
+		catch (...)
+		{
+			state.fail();
+		}
+	});
+
+	for (std::size_t k = 0; k < this->stages.size(); k++)
+	{
+		threads.emplace_back([&, k]()
+		{
+			try
+			{
+				Chunk* chunk;
+				while (pop(*links[k], chunk, state))
+				{
+					if (chunk != nullptr)
+						this->stages[k](*chunk);
+					if (!push(*links[k + 1], chunk, state) || chunk == nullptr)
+						return;
+				}
+			}
+			catch (...)
+			{
+				state.fail();
+			}
+		});
+	}
+
+	try
+	{
+		Chunk* chunk;
+		while (pop(*links.back(), chunk, state) && chunk != nullptr)
+		{
+			sink(chunk->data(), chunk->size());
+			if (!push(free, chunk, state))
+				break;
+		}
+	}
+	catch (...)
+	{
+		state.fail();
+	}
+
+	for (std::thread& thread : threads)
+		thread.join();
+	if (state.error)
+		std::rethrow_exception(state.error);
+}
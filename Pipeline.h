@@ -0,0 +1,74 @@
+#ifndef PIPELINE_H
+#define PIPELINE_H
+#include<cstddef>
+#include<functional>
+#include<vector>
+#include"Mat2x2.h"
+
+/*
+* a streaming pipeline over Mat2x2 values
+
+	source -> stage -> ... -> stage -> sink
+
+* the source and every stage run on their own thread, the sink on the
+	thread that calls run(), and they hand chunks of matrices to each
+	other through lock-free SPSC queues. The
+	chunks come from a fixed pool that the sink hands back to the source,
+	so a full pipeline stalls the source (backpressure) and peak memory
+	is the pool size, however long the input is.
+*/
+class Pipeline
+{
+public:
+	/*
+	* a buffer from the pool: capacity() matrices are allocated once, the
+		first size() of them hold data. Shrinking only lowers the count,
+		so a recycled chunk is refilled without being cleared first
+	*/
+	class Chunk
+	{
+	private:
+		std::vector<Mat2x2> storage;
+		std::size_t count;
+	public:
+		explicit Chunk(std::size_t = 0);
+
+		std::size_t size() const;
+		std::size_t capacity() const;
+		Mat2x2* data();
+		const Mat2x2* data() const;
+		Mat2x2* begin();
+		Mat2x2* end();
+		const Mat2x2* begin() const;
+		const Mat2x2* end() const;
+		Mat2x2& operator[](std::size_t);
+		const Mat2x2& operator[](std::size_t) const;
+
+		//no more than capacity(), new matrices are whatever the buffer held before
+		void resize(std::size_t);
+		Mat2x2* erase(Mat2x2*, Mat2x2*);
+	};
+
+	//fills up to the given number of matrices, returns how many, 0 at the end of the input.
+	//Returning more is a bug in the source and makes run() throw std::logic_error
+	typedef std::function<std::size_t(Mat2x2*, std::size_t)> Source;
+	//transforms a chunk in place, it may shrink the chunk but not grow it past capacity()
+	typedef std::function<void(Chunk&)> Stage;
+	//consumes the matrices of one chunk
+	typedef std::function<void(const Mat2x2*, std::size_t)> Sink;
+private:
+	std::size_t chunkSize;
+	std::size_t queueDepth;
+	std::vector<Stage> stages;
+public:
+	//1024 matrices is 32 KB, a chunk stays in L1/L2 while every stage touches it
+	explicit Pipeline(std::size_t = 1024, std::size_t = 4);
+
+	Pipeline& then(Stage);
+	Pipeline& map(std::function<void(Mat2x2&)>);
+	Pipeline& filter(std::function<bool(const Mat2x2&)>);
+
+	std::size_t chunks() const;
+	void run(Source, Sink);
+};
+#endif
@@ -0,0 +1,184 @@
+#include "PropertyCheck.h"
+#include "Conditioning.h"
+#include<algorithm>
+#include<cfloat>
+#include<cmath>
+#include<stdexcept>
+#include<thread>
+#include<vector>
+
+namespace
+{
+	//allowed error, in units of DBL_EPSILON times the size of the problem
+	const double tolerance = 32 * DBL_EPSILON;
+
+	PropertyResult emptyResult()
+	{
+		PropertyResult result;
+		result.checked = 0;
+		result.skipped = 0;
+		result.failures = 0;
+		result.firstFailure = noFailure;
+		return result;
+	}
+
+	void record(PropertyResult& result, bool ok, std::size_t index)
+	{
+		result.checked++;
+		if (!ok)
+		{
+			result.failures++;
+			result.firstFailure = std::min(result.firstFailure, index);
+		}
+	}
+
+	void merge(PropertyResult& into, const PropertyResult& from)
+	{
+		into.checked += from.checked;
+		into.skipped += from.skipped;
+		into.failures += from.failures;
+		into.firstFailure = std::min(into.firstFailure, from.firstFailure);
+	}
+
+	double maxAbs(Mat2x2& m)
+	{
+		return std::max(std::max(std::abs(m[0]), std::abs(m[1])), std::max(std::abs(m[2]), std::abs(m[3])));
+	}
+
+	/*
+	* m * m.inverse() should be the identity up to rounding that grows
+		with the condition number. Where inverse() must reject m the
+		check is that it throws; elsewhere matrices it rejects are skipped.
+	*/
+	void checkInverse(Mat2x2 m, std::size_t index, bool mustThrow, PropertyResult& result)
+	{
+		Mat2x2 inv;
+		bool threw = false;
+		try
+		{
+			inv = m.inverse();
+		}
+		catch (const std::overflow_error&)
+		{
+			threw = true;
+		}
+		if (mustThrow)
+		{
+			record(result, threw, index);
+			return;
+		}
+		if (threw)
+		{
+			result.skipped++;
+			return;
+		}
+		const double bound = tolerance * conditionNumber(m);
+		Mat2x2 identity(1, 0, 0, 1);
+		Mat2x2 residual = m * inv;
+		residual -= identity;
+		const double error = maxAbs(residual);
+		if (!std::isfinite(bound) || !std::isfinite(error))
+		{
+			result.skipped++;
+			return;
+		}
+		record(result, error <= bound, index);
+	}
+
+	void checkTranspose(Mat2x2 m, std::size_t index, PropertyResult& result)
+	{
+		record(result, m.transpose().transpose() == m, index);
+	}
+
+	/*
+	* det(lhs * rhs) and det(lhs) * det(rhs) agree up to rounding relative
+		to |lhs|_F^2 |rhs|_F^2. Overflowing or underflowing pairs are skipped.
+	*/
+	void checkDeterminant(Mat2x2 lhs, Mat2x2 rhs, std::size_t index, PropertyResult& result)
+	{
+		const double scale = std::pow(normFrobenius(lhs) * normFrobenius(rhs), 2.0);
+		const double product = (lhs * rhs).determinant();
+		const double expected = lhs.determinant() * rhs.determinant();
+		if (!std::isfinite(scale) || !std::isfinite(product) || scale < DBL_MIN / DBL_EPSILON)
+		{
+			result.skipped++;
+			return;
+		}
+		record(result, std::abs(product - expected) <= tolerance * scale, index);
+	}
+}
+
+/*
+* @return true if every identity was checked on at least one sample and
+	failed on none, a distribution that only produced skips proves nothing
+*/
+bool PropertyReport::passed() const
+{
+	const PropertyResult* results[] = { &this->inverse, &this->transpose, &this->determinant };
+	for (const PropertyResult* result : results)
+		if (result->checked == 0 || result->failures != 0)
+			return false;
+	return true;
+}
+
+/*
+* to check the algebraic identities of Mat2x2 over a random dataset,
+	generating and checking it block by block on several threads
+
+* @param  distribution - the kind of matrices to generate
+* @param  samples - the number of matrices to check
+* @param  seed - the seed of the dataset, reported failures can be
+	reproduced with generate() and the same seed
+* @param  threads - the number of threads to use, 0 for one per core
+
+* @return the number of checks, skips and failures of every identity
+*/
+PropertyReport checkProperties(Distribution distribution, std::size_t samples, std::uint64_t seed, unsigned threads)
+{
+	const std::size_t blocks = (samples + generatorBlockSize - 1) / generatorBlockSize;
+	if (threads == 0)
+		threads = std::max(1u, std::thread::hardware_concurrency());
+	threads = static_cast<unsigned>(std::min<std::size_t>(threads, std::max<std::size_t>(blocks, 1)));
+
+	PropertyReport empty;
+	empty.inverse = emptyResult();
+	empty.transpose = emptyResult();
+	empty.determinant = emptyResult();
+	std::vector<PropertyReport> reports(threads, empty);
+	//the determinant of these is zero or within 1e-10 of it, far below what inverse() accepts
+	const bool mustThrow = distribution == Distribution::Singular || distribution == Distribution::NearSingular;
+
+	auto work = [&](unsigned t)
+	{
+		std::vector<Mat2x2> m(generatorBlockSize);
+		PropertyReport& report = reports[t];
+		for (std::size_t block = t; block < blocks; block += threads)
+		{
+			const std::size_t first = block * generatorBlockSize;
+			const std::size_t count = std::min(generatorBlockSize, samples - first);
+			generateBlock(distribution, m.data(), count, seed, block);
+			for (std::size_t i = 0; i < count; i++)
+			{
+				checkInverse(m[i], first + i, mustThrow, report.inverse);
+				checkTranspose(m[i], first + i, report.transpose);
+				if (i + 1 < count)
+					checkDeterminant(m[i], m[i + 1], first + i, report.determinant);
+			}
+		}
+	};
+	std::vector<std::thread> pool;
+	for (unsigned t = 1; t < threads; t++)
+		pool.emplace_back(work, t);
+	work(0);
+	for (std::thread& thread : pool)
+		thread.join();
+
+	PropertyReport result = empty;
+	for (const PropertyReport& report : reports)
+	{
+		merge(result.inverse, report.inverse);
+		merge(result.transpose, report.transpose);
+		merge(result.determinant, report.determinant);
+	}
+	return result;
+}
@@ -0,0 +1,33 @@
+#ifndef PROPERTYCHECK_H
+#define PROPERTYCHECK_H
+#include<cstddef>
+#include<cstdint>
+#include"MatrixGenerator.h"
+
+/*
+* the outcome of checking one identity over a dataset
+
+* firstFailure is the index of the first failing sample, which together
+	with the seed and distribution reproduces it, or noFailure
+*/
+struct PropertyResult
+{
+	std::size_t checked;
+	std::size_t skipped;
+	std::size_t failures;
+	std::size_t firstFailure;
+};
+
+const std::size_t noFailure = static_cast<std::size_t>(-1);
+
+struct PropertyReport
+{
+	PropertyResult inverse;			//m * m.inverse() is the identity, or inverse() throws for Singular and NearSingular
+	PropertyResult transpose;		//m.transpose().transpose() == m
+	PropertyResult determinant;		//det(m[i] * m[i + 1]) == det(m[i]) * det(m[i + 1]) within a block
+
+	bool passed() const;
+};
+
+PropertyReport checkProperties(Distribution, std::size_t, std::uint64_t, unsigned = 0);
+#endif
@@ -0,0 +1,693 @@
+#include "ShardedBatch.h"
+#include "CpuDispatch.h"
+#include<algorithm>
+#include<chrono>
+#include<condition_variable>
+#include<cstdint>
+#include<cstring>
+#include<deque>
+#include<functional>
+#include<memory>
+#include<stdexcept>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define SHARDED_POSIX
+#include<netdb.h>
+#include<netinet/in.h>
+#include<netinet/tcp.h>
+#include<poll.h>
+#include<sys/mman.h>
+#include<sys/socket.h>
+#include<sys/time.h>
+#include<sys/types.h>
+#include<sys/wait.h>
+#include<unistd.h>
+#endif
+
+namespace
+{
+	static_assert(sizeof(Mat2x2) == 4 * sizeof(double), "Mat2x2 must be four packed doubles");
+	static_assert(sizeof(Eigenvalues) == sizeof(Mat2x2), "Eigenvalues must fit in place of a Mat2x2");
+
+	//a shard sent over TCP, followed by count matrices
+	struct ShardHeader
+	{
+		std::uint32_t operation;
+		std::uint32_t reserved;
+		std::uint64_t count;
+	};
+
+	//larger shards are refused, a corrupt header cannot make a worker allocate without bound
+	const std::uint64_t maxShardSize = std::uint64_t(1) << 24;
+
+	bool isReduction(ShardOperation operation)
+	{
+		return operation == ShardOperation::Product || operation == ShardOperation::Sum;
+	}
+
+	std::size_t resultCount(ShardOperation operation, std::size_t n)
+	{
+		return isReduction(operation) ? 1 : n;
+	}
+
+	//allocates nothing, it also runs in forked worker processes
+	void computeShard(ShardOperation operation, const Mat2x2* in, std::size_t n, Mat2x2* out)
+	{
+		switch (operation)
+		{
+		case ShardOperation::Product:
+		{
+			Mat2x2 product(1, 0, 0, 1);
+			for (std::size_t i = 0; i < n; i++)
+			{
+				Mat2x2 m = in[i];
+				product *= m;
+			}
+			*out = product;
+			break;
+		}
+		case ShardOperation::Sum:
+		{
+			Mat2x2 sum;
+			for (std::size_t i = 0; i < n; i++)
+			{
+				Mat2x2 m = in[i];
+				sum += m;
+			}
+			*out = sum;
+			break;
+		}
+		case ShardOperation::Inverse:
+			kernels().inverse(in, out, n);
+			break;
+		case ShardOperation::Eigenvalues:
+			kernels().eigenvalues(in, reinterpret_cast<Eigenvalues*>(out), n);
+			break;
+		}
+	}
+
+	/*
+	* hands out shards to the worker threads of the coordinator. A shard
+		given back after a failure is handed out again before new ones,
+		and take() waits while shards are still in flight, so one may
+		come back.
+	*/
+	class Scheduler
+	{
+	private:
+		std::mutex mutex;
+		std::condition_variable changed;
+		std::size_t shards, next, inFlight, live, retries;
+		std::deque<std::size_t> retry;
+		std::vector<std::size_t> attempts;
+	public:
+		std::size_t restarts;
+		std::string failure;
+
+		Scheduler(std::size_t shards, std::size_t workers, std::size_t retries)
+			: shards{ shards }, next{ 0 }, inFlight{ 0 }, live{ workers }, retries{ retries },
+			attempts(shards), restarts{ 0 }
+		{
+		}
+
+		bool take(std::size_t& shard)
+		{
+			std::unique_lock<std::mutex> lock(this->mutex);
+			for (;;)
+			{
+				if (!this->failure.empty())
+					return false;
+				if (!this->retry.empty())
+				{
+					shard = this->retry.front();
+					this->retry.pop_front();
+					this->inFlight++;
+					return true;
+				}
+				if (this->next < this->shards)
+				{
+					shard = this->next++;
+					this->inFlight++;
+					return true;
+				}
+				if (this->inFlight == 0)
+					return false;
+				this->changed.wait(lock);
+			}
+		}
+
+		void complete()
+		{
+			std::lock_guard<std::mutex> lock(this->mutex);
+			this->inFlight--;
+			this->changed.notify_all();
+		}
+
+		void giveBack(std::size_t shard)
+		{
+			std::lock_guard<std::mutex> lock(this->mutex);
+			this->inFlight--;
+			this->restarts++;
+			if (++this->attempts[shard] > this->retries)
+				this->failure = "shard failed on every attempt";
+			else
+				this->retry.push_back(shard);
+			this->changed.notify_all();
+		}
+
+		//a worker that cannot be reached again leaves, the last one fails what is left
+		void leave()
+		{
+			std::lock_guard<std::mutex> lock(this->mutex);
+			if (--this->live == 0 && this->failure.empty() && (!this->retry.empty() || this->next < this->shards))
+				this->failure = "no worker left";
+			this->changed.notify_all();
+		}
+	};
+
+	//what the coordinator asks for, the pointers may point into shared memory
+	struct Job
+	{
+		ShardOperation operation;
+		const Mat2x2* in;
+		Mat2x2* out;
+		Mat2x2* partials;
+		std::size_t n;
+		std::size_t shardSize;
+
+		std::size_t first(std::size_t shard) const
+		{
+			return shard * this->shardSize;
+		}
+
+		std::size_t count(std::size_t shard) const
+		{
+			return std::min(this->shardSize, this->n - this->first(shard));
+		}
+
+		Mat2x2* results(std::size_t shard) const
+		{
+			return isReduction(this->operation) ? this->partials + shard : this->out + this->first(shard);
+		}
+	};
+
+	//one worker as seen from the coordinator
+	class Link
+	{
+	public:
+		virtual ~Link() {}
+		virtual bool open() = 0;
+		virtual void close() = 0;
+		//false if the worker was lost, the shard must be sent again
+		virtual bool run(std::size_t) = 0;
+	};
+
+	void workLoop(Link& link, Scheduler& scheduler, std::size_t retries)
+	{
+		auto reopen = [&]()
+		{
+			for (std::size_t attempt = 0; attempt <= retries; attempt++)
+			{
+				if (link.open())
+					return true;
+				std::this_thread::sleep_for(std::chrono::milliseconds(50 * (attempt + 1)));
+			}
+			return false;
+		};
+		std::size_t shard;
+		if (reopen())
+		{
+			while (scheduler.take(shard))
+			{
+				if (link.run(shard))
+				{
+					scheduler.complete();
+					continue;
+				}
+				scheduler.giveBack(shard);
+				link.close();
+				if (!reopen())
+					break;
+			}
+		}
+		link.close();
+		scheduler.leave();
+	}
+
+#ifdef SHARDED_POSIX
+#ifdef MSG_NOSIGNAL
+	const int sendFlags = MSG_NOSIGNAL;
+#else
+	const int sendFlags = 0;
+#endif
+
+	bool sendAll(int fd, const void* data, std::size_t bytes)
+	{
+		const char* p = static_cast<const char*>(data);
+		while (bytes > 0)
+		{
+			const ssize_t sent = ::send(fd, p, bytes, sendFlags);
+			if (sent <= 0)
+				return false;
+			p += sent;
+			bytes -= static_cast<std::size_t>(sent);
+		}
+		return true;
+	}
+
+	bool receiveAll(int fd, void* data, std::size_t bytes)
+	{
+		char* p = static_cast<char*>(data);
+		while (bytes > 0)
+		{
+			const ssize_t received = ::recv(fd, p, bytes, 0);
+			if (received <= 0)
+				return false;
+			p += received;
+			bytes -= static_cast<std::size_t>(received);
+		}
+		return true;
+	}
+
+	void noDelay(int fd)
+	{
+		int on = 1;
+		::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof on);
+#ifdef SO_NOSIGPIPE
+		::setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof on);
+#endif
+	}
+
+	//after this, receiveAll() and sendAll() on fd fail instead of blocking for longer than milliseconds
+	void stallTimeout(int fd, std::size_t milliseconds)
+	{
+		timeval limit;
+		limit.tv_sec = static_cast<time_t>(milliseconds / 1000);
+		limit.tv_usec = static_cast<suseconds_t>(milliseconds % 1000 * 1000);
+		::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &limit, sizeof limit);
+		::setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &limit, sizeof limit);
+	}
+
+	int connectTo(const std::string& endpoint)
+	{
+		const std::size_t colon = endpoint.rfind(':');
+		if (colon == std::string::npos)
+			return -1;
+		const std::string host = endpoint.substr(0, colon), port = endpoint.substr(colon + 1);
+		addrinfo hints;
+		std::memset(&hints, 0, sizeof hints);
+		hints.ai_family = AF_UNSPEC;
+		hints.ai_socktype = SOCK_STREAM;
+		addrinfo* found = nullptr;
+		if (::getaddrinfo(host.c_str(), port.c_str(), &hints, &found) != 0)
+			return -1;
+		int fd = -1;
+		for (addrinfo* address = found; address != nullptr && fd < 0; address = address->ai_next)
+		{
+			fd = ::socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+			if (fd >= 0 && ::connect(fd, address->ai_addr, address->ai_addrlen) != 0)
+			{
+				::close(fd);
+				fd = -1;
+			}
+		}
+		::freeaddrinfo(found);
+		if (fd >= 0)
+			noDelay(fd);
+		return fd;
+	}
+
+	//a ShardServer, every shard travels over the connection
+	class TcpLink : public Link
+	{
+	private:
+		const Job& job;
+		std::string endpoint;
+		int fd;
+	public:
+		TcpLink(const Job& job, const std::string& endpoint) : job(job), endpoint{ endpoint }, fd{ -1 } {}
+		~TcpLink() { this->close(); }
+
+		bool open() override
+		{
+			this->fd = connectTo(this->endpoint);
+			return this->fd >= 0;
+		}
+
+		void close() override
+		{
+			if (this->fd >= 0)
+				::close(this->fd);
+			this->fd = -1;
+		}
+
+		bool run(std::size_t shard) override
+		{
+			const std::size_t n = this->job.count(shard);
+			ShardHeader header = { static_cast<std::uint32_t>(this->job.operation), 0, n };
+			return sendAll(this->fd, &header, sizeof header)
+				&& sendAll(this->fd, this->job.in + this->job.first(shard), n * sizeof(Mat2x2))
+				&& receiveAll(this->fd, this->job.results(shard), resultCount(this->job.operation, n) * sizeof(Mat2x2));
+		}
+	};
+
+	//forks are serialised so that no child inherits another child's end of its socket pair
+	std::mutex forkMutex;
+
+	/*
+	* a forked worker process. The input, the results and the partials
+		all live in memory shared with it, only shard numbers travel
+		over the socket pair.
+	*/
+	class ProcessLink : public Link
+	{
+	private:
+		const Job& job;
+		pid_t pid;
+		int fd;
+	public:
+		explicit ProcessLink(const Job& job) : job(job), pid{ -1 }, fd{ -1 } {}
+		~ProcessLink() { this->close(); }
+
+		bool open() override
+		{
+			std::lock_guard<std::mutex> lock(forkMutex);
+			int ends[2];
+			if (::socketpair(AF_UNIX, SOCK_STREAM, 0, ends) != 0)
+				return false;
+			this->pid = ::fork();
+			if (this->pid == 0)
+			{
+				//the child only computes and talks over its socket, then leaves without running destructors
+				::close(ends[0]);
+				std::uint64_t shard;
+				while (receiveAll(ends[1], &shard, sizeof shard))
+				{
+					computeShard(this->job.operation, this->job.in + this->job.first(shard), this->job.count(shard),
+						this->job.results(shard));
+					if (!sendAll(ends[1], &shard, sizeof shard))
+						break;
+				}
+				::_exit(0);
+			}
+			::close(ends[1]);
+			if (this->pid < 0)
+			{
+				::close(ends[0]);
+				return false;
+			}
+			this->fd = ends[0];
+			return true;
+		}
+
+		void close() override
+		{
+			if (this->fd >= 0)
+			{
+				//shutdown reaches the child even if a sibling inherited this end
+				::shutdown(this->fd, SHUT_RDWR);
+				::close(this->fd);
+				this->fd = -1;
+			}
+			if (this->pid > 0)
+			{
+				::waitpid(this->pid, nullptr, 0);
+				this->pid = -1;
+			}
+		}
+
+		bool run(std::size_t shard) override
+		{
+			std::uint64_t sent = shard, done;
+			return sendAll(this->fd, &sent, sizeof sent) && receiveAll(this->fd, &done, sizeof done) && done == sent;
+		}
+	};
+
+	//an anonymous mapping shared with every process forked after it
+	class SharedMemory
+	{
+	private:
+		void* data;
+		std::size_t bytes;
+	public:
+		explicit SharedMemory(std::size_t bytes) : bytes{ bytes }
+		{
+			this->data = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+			if (this->data == MAP_FAILED)
+				throw std::runtime_error("cannot map shared memory");
+		}
+		SharedMemory(const SharedMemory&) = delete;
+		SharedMemory& operator=(const SharedMemory&) = delete;
+		~SharedMemory() { ::munmap(this->data, this->bytes); }
+
+		Mat2x2* matrices() const
+		{
+			return static_cast<Mat2x2*>(this->data);
+		}
+	};
+#endif
+}
+
+/*
+* to run a batch operation over shards on local processes or remote workers
+
+* @param  operation - what every worker computes
+* @param  in - pointer to the first matrix
+* @param  out - pointer to the first result of Inverse and Eigenvalues,
+	may be nullptr for Product and Sum
+* @param  n - the number of matrices
+* @param  options - shard size, workers and retries
+
+* @return the combined reduction and the number of restarts
+*/
+ShardedResult runSharded(ShardOperation operation, const Mat2x2* in, Mat2x2* out, std::size_t n, const ShardOptions& options)
+{
+	if (options.shardSize == 0 || options.shardSize > maxShardSize || (!isReduction(operation) && out == nullptr)
+		|| (options.endpoints.empty() && options.localWorkers == 0))
+		throw std::invalid_argument("Invalid arguments");
+#ifndef SHARDED_POSIX
+	throw std::runtime_error("sharded execution needs POSIX sockets");
+#else
+	const std::size_t shards = (n + options.shardSize - 1) / options.shardSize;
+	const bool local = options.endpoints.empty();
+	//the dispatch choice is fixed before any fork, children never run its initialisation
+	kernels();
+
+	std::vector<Mat2x2> partials(local ? 0 : shards);
+	std::unique_ptr<SharedMemory> shared;
+	Job job = { operation, in, out, partials.data(), n, options.shardSize };
+	if (local)
+	{
+		//input, then the results of Inverse and Eigenvalues, then the partials
+		const std::size_t outputs = isReduction(operation) ? 0 : n;
+		shared.reset(new SharedMemory((n + outputs + shards + 1) * sizeof(Mat2x2)));
+		Mat2x2* base = shared->matrices();
+		std::copy(in, in + n, base);
+		job.in = base;
+		job.out = base + n;
+		job.partials = base + n + outputs;
+	}
+
+	std::vector<std::unique_ptr<Link>> links;
+	if (local)
+	{
+		for (std::size_t w = 0; w < options.localWorkers; w++)
+			links.emplace_back(new ProcessLink(job));
+	}
+	else
+	{
+		for (const std::string& endpoint : options.endpoints)
+			links.emplace_back(new TcpLink(job, endpoint));
+	}
+
+	Scheduler scheduler(shards, links.size(), options.retries);
+	std::vector<std::thread> threads;
+	for (std::unique_ptr<Link>& link : links)
+		threads.emplace_back(workLoop, std::ref(*link), std::ref(scheduler), options.retries);
+	for (std::thread& thread : threads)
+		thread.join();
+	if (!scheduler.failure.empty())
+		throw std::runtime_error(scheduler.failure);
+
+	ShardedResult result;
+	result.restarts = scheduler.restarts;
+	if (operation == ShardOperation::Product)
+		result.reduction = Mat2x2(1, 0, 0, 1);
+	for (std::size_t s = 0; s < shards && isReduction(operation); s++)
+	{
+		if (operation == ShardOperation::Product)
+			result.reduction *= job.partials[s];
+		else
+			result.reduction += job.partials[s];
+	}
+	if (local && !isReduction(operation))
+		std::copy(job.out, job.out + n, out);
+	return result;
+#endif
+}
+
+/*
+* constructor starts listening on every interface
+
+* @param  port - the TCP port, 0 for any free one
+*/
+ShardServer::ShardServer(unsigned short port) : listener{ -1 }, boundPort{ 0 }, dropAfter{ 0 }, stallMilliseconds{ 5000 }, stopped{ false }
+{
+#ifndef SHARDED_POSIX
+	throw std::runtime_error("sharded execution needs POSIX sockets");
+#else
+	this->listener = ::socket(AF_INET, SOCK_STREAM, 0);
+	int on = 1;
+	::setsockopt(this->listener, SOL_SOCKET, SO_REUSEADDR, &on, sizeof on);
+	sockaddr_in address;
+	std::memset(&address, 0, sizeof address);
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl(INADDR_ANY);
+	address.sin_port = htons(port);
+	socklen_t length = sizeof address;
+	if (this->listener < 0 || ::bind(this->listener, reinterpret_cast<sockaddr*>(&address), sizeof address) != 0
+		|| ::listen(this->listener, 16) != 0
+		|| ::getsockname(this->listener, reinterpret_cast<sockaddr*>(&address), &length) != 0)
+	{
+		if (this->listener >= 0)
+			::close(this->listener);
+		throw std::runtime_error("cannot listen on port " + std::to_string(port));
+	}
+	this->boundPort = ntohs(address.sin_port);
+#endif
+}
+
+/*
+* destructor stops listening, serve() must have returned
+*/
+ShardServer::~ShardServer()
+{
+#ifdef SHARDED_POSIX
+	if (this->listener >= 0)
+		::close(this->listener);
+#endif
+}
+
+/*
+* @return the port the server listens on
+*/
+unsigned short ShardServer::port() const
+{
+	return this->boundPort;
+}
+
+/*
+* @param  shards - the number of shards a connection answers before it is dropped, 0 for never
+*/
+void ShardServer::dropConnectionsAfter(std::size_t shards)
+{
+	this->dropAfter = shards;
+}
+
+/*
+* @param  milliseconds - how long a shard may wait for its next byte to arrive or leave
+*/
+void ShardServer::dropStalledAfter(std::size_t milliseconds)
+{
+	this->stallMilliseconds = milliseconds;
+}
+
+/*
+* to accept coordinators and serve their shards until stop() is called,
+	returns once every connection has ended. Connections that ended are
+	joined as serve() goes, so the threads held are the live connections
+*/
+void ShardServer::serve()
+{
+#ifdef SHARDED_POSIX
+	while (!this->stopped)
+	{
+		this->reap(false);
+		//wake up regularly to notice stop() and ended connections
+		pollfd ready = { this->listener, POLLIN, 0 };
+		if (::poll(&ready, 1, 100) <= 0)
+			continue;
+		const int fd = ::accept(this->listener, nullptr, nullptr);
+		if (fd < 0)
+			continue;
+		noDelay(fd);
+		stallTimeout(fd, this->stallMilliseconds);
+		this->connections.emplace_back();
+		Connection& connection = this->connections.back();
+		connection.thread = std::thread(&ShardServer::handle, this, fd, std::ref(connection.finished));
+	}
+	this->reap(true);
+#endif
+}
+
+/*
+* to join connection threads, only serve() touches the list
+
+* @param  all - also wait for the connections still running
+*/
+void ShardServer::reap(bool all)
+{
+	for (std::list<Connection>::iterator connection = this->connections.begin(); connection != this->connections.end();)
+	{
+		if (all || connection->finished.load(std::memory_order_acquire))
+		{
+			connection->thread.join();
+			connection = this->connections.erase(connection);
+		}
+		else
+			++connection;
+	}
+}
+
+/*
+* to make serve() return, connections in progress end when their coordinator
+	disconnects or within 100 ms. Before serve() it makes serve() return at once
+*/
+void ShardServer::stop()
+{
+	this->stopped = true;
+}
+
+/*
+* to serve the shards of one coordinator. Between shards it waits for
+	the next one until stop(), within a shard it drops a coordinator that
+	stalls for longer than dropStalledAfter()
+
+* @param  fd - the connected socket
+* @param  finished - set when the connection has ended
+*/
+void ShardServer::handle(int fd, std::atomic<bool>& finished)
+{
+#ifdef SHARDED_POSIX
+	std::vector<Mat2x2> in, out;
+	std::size_t served = 0;
+	for (;;)
+	{
+		pollfd ready = { fd, POLLIN, 0 };
+		const int polled = ::poll(&ready, 1, 100);
+		if (this->stopped)
+			break;
+		if (polled <= 0)
+			continue;
+		ShardHeader header;
+		if (!receiveAll(fd, &header, sizeof header) || header.operation > 3 || header.count > maxShardSize)
+			break;
+		const ShardOperation operation = static_cast<ShardOperation>(header.operation);
+		const std::size_t n = static_cast<std::size_t>(header.count);
+		in.resize(n);
+		if (!receiveAll(fd, in.data(), n * sizeof(Mat2x2)))
+			break;
+		if (this->dropAfter != 0 && served == this->dropAfter)
+			break;
+		out.resize(resultCount(operation, n));
+		computeShard(operation, in.data(), n, out.data());
+		if (!sendAll(fd, out.data(), out.size() * sizeof(Mat2x2)))
+			break;
+		served++;
+	}
+	::close(fd);
+#else
+	(void)fd;
+#endif
+	finished.store(true, std::memory_order_release);
+}
@@ -0,0 +1,108 @@
+#ifndef SHARDEDBATCH_H
+#define SHARDEDBATCH_H
+#include<atomic>
+#include<cstddef>
+#include<list>
+#include<string>
+#include<thread>
+#include<vector>
+#include"Mat2x2.h"
+
+/*
+* what every worker computes for its shard
+
+	Product - the ordered product in[first] * ... * in[last]
+	Sum - the sum of the shard
+	Inverse - out[i] = in[i].inverse(), all NaN where it has none
+	Eigenvalues - out[i] = |re1 im1; re2 im2|, like processFile()
+*/
+enum class ShardOperation
+{
+	Product,
+	Sum,
+	Inverse,
+	Eigenvalues
+};
+
+/*
+* endpoints - "host:port" of ShardServer workers. When empty,
+	localWorkers processes are forked instead and exchange data with
+	the coordinator through shared memory. List an endpoint several times
+	to run several shards on that host at once.
+* retries - how often a shard is retried, and a lost worker is
+	reconnected or restarted, before giving up
+*/
+struct ShardOptions
+{
+	std::size_t shardSize = 64 * 1024;
+	std::size_t localWorkers = 4;
+	std::vector<std::string> endpoints;
+	std::size_t retries = 3;
+};
+
+/*
+* reduction - the combined Product or Sum, identity or zero otherwise
+* restarts - how many times a worker was lost and a shard sent again
+*/
+struct ShardedResult
+{
+	Mat2x2 reduction;
+	std::size_t restarts;
+};
+
+/*
+* to split n matrices into shards, run them on workers and combine the
+	partial products or sums in shard order
+
+* a worker that dies or drops its connection is restarted or
+	reconnected and its shard is sent again, to it or to any other
+	worker. Matrices cross TCP in native byte order, so every host must
+	share the coordinator's. POSIX only, throws std::runtime_error
+	elsewhere.
+*/
+ShardedResult runSharded(ShardOperation, const Mat2x2*, Mat2x2*, std::size_t, const ShardOptions& = ShardOptions());
+
+/*
+* a remote worker: serves shards to coordinators over TCP, one thread
+	per connection, until stop() is called. stop() may come from any
+	thread and at any time, also before serve() has started; a stopped
+	server stays stopped
+
+	ShardServer server(7000);
+	server.serve();
+*/
+class ShardServer
+{
+private:
+	int listener;
+	unsigned short boundPort;
+	std::size_t dropAfter;
+	std::size_t stallMilliseconds;
+	std::atomic<bool> stopped;
+
+	//finished is set by the connection's own thread, serve() joins it soon after
+	struct Connection
+	{
+		std::thread thread;
+		std::atomic<bool> finished{ false };
+	};
+	std::list<Connection> connections;
+	void reap(bool);
+	void handle(int, std::atomic<bool>&);
+public:
+	//0 picks a free port
+	explicit ShardServer(unsigned short = 0);
+	ShardServer(const ShardServer&) = delete;
+	ShardServer& operator=(const ShardServer&) = delete;
+	~ShardServer();
+
+	unsigned short port() const;
+	void serve();
+	void stop();
+
+	//for testing coordinators: drop every connection without answering its (shards + 1)-th shard
+	void dropConnectionsAfter(std::size_t);
+	//a coordinator that stalls this long in the middle of a shard is dropped, 5 s by default
+	void dropStalledAfter(std::size_t);
+};
+#endif
@@ -0,0 +1,116 @@
+#include "SlidingWindow.h"
+#include<stdexcept>
+
+/*
+* constructor creates an empty window
+
+* @param  window - the most matrices kept, push() drops the oldest
+	beyond it, 0 for no limit
+*/
+SlidingWindow::SlidingWindow(std::size_t window) : window{ window }, backProduct(1, 0, 0, 1)
+{
+}
+
+/*
+* to move the back stack onto the empty front one, newest first, so
+	the oldest ends on top
+*/
+void SlidingWindow::flip()
+{
+	Mat2x2 product(1, 0, 0, 1), sum;
+	this->front.reserve(this->back.size());
+	for (std::size_t i = this->back.size(); i-- > 0;)
+	{
+		product = this->back[i] * product;
+		sum += this->back[i];
+		this->front.push_back({ product, sum });
+	}
+	this->back.clear();
+	this->backProduct = Mat2x2(1, 0, 0, 1);
+	this->backSum = Mat2x2();
+}
+
+/*
+* to add the newest matrix, dropping the oldest if the window is full
+
+* @param  m - a referrence to a 2x2 matrix
+*/
+void SlidingWindow::push(const Mat2x2& m)
+{
+	if (this->window != 0 && this->size() == this->window)
+		this->pop();
+	this->back.push_back(m);
+	this->backProduct *= this->back.back();
+	this->backSum += this->back.back();
+}
+
+/*
+* to drop the oldest matrix
+*/
+void SlidingWindow::pop()
+{
+	if (this->empty())
+		throw std::invalid_argument("index out of bound");
+	if (this->front.empty())
+		this->flip();
+	this->front.pop_back();
+}
+
+/*
+* to drop every matrix, the capacity stays
+*/
+void SlidingWindow::clear()
+{
+	this->front.clear();
+	this->back.clear();
+	this->backProduct = Mat2x2(1, 0, 0, 1);
+	this->backSum = Mat2x2();
+}
+
+/*
+* @return the number of matrices in the window
+*/
+std::size_t SlidingWindow::size() const
+{
+	return this->front.size() + this->back.size();
+}
+
+/*
+* @return true if the window holds no matrix
+*/
+bool SlidingWindow::empty() const
+{
+	return this->size() == 0;
+}
+
+/*
+* @return the most matrices kept, 0 for no limit
+*/
+std::size_t SlidingWindow::capacity() const
+{
+	return this->window;
+}
+
+/*
+* @return the ordered product oldest * ... * newest, the identity when empty
+*/
+Mat2x2 SlidingWindow::product() const
+{
+	if (this->front.empty())
+		return this->backProduct;
+	Mat2x2 result = this->front.back().product;
+	Mat2x2 backProduct = this->backProduct;
+	return result *= backProduct;
+}
+
+/*
+* @return the sum of the window, zero when empty
+*/
+Mat2x2 SlidingWindow::sum() const
+{
+	if (this->front.empty())
+		return this->backSum;
+	Mat2x2 result = this->front.back().sum;
+	Mat2x2 backSum = this->backSum;
+	return result += backSum;
+}
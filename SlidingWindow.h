@@ -0,0 +1,60 @@
+#ifndef SLIDINGWINDOW_H
+#define SLIDINGWINDOW_H
+#include<cstddef>
+#include<vector>
+#include"Mat2x2.h"
+
+/*
+* the ordered product oldest * ... * newest and the sum of the last
+	matrices of a stream, without dividing anything out, so singular
+	matrices are fine
+
+* two stacks: new matrices go on the back one, which keeps its running
+	product and sum. The front one holds the oldest matrices, each with
+	the product and sum from it up to the newest matrix in the front
+	stack, so removing the oldest is a pop. When the front runs empty
+	the back is moved over in one pass, every matrix is moved once.
+	push() and pop() therefore cost amortized O(1) products and sums,
+	product() at most one and sum() at most one addition.
+
+* no value is ever subtracted, so sums do not drift however long the
+	stream runs
+
+	SlidingWindow window(1000);
+	for (Mat2x2& m : stream)
+	{
+		window.push(m);
+		Mat2x2 transform = window.product();
+	}
+*/
+class SlidingWindow
+{
+private:
+	struct Suffix
+	{
+		Mat2x2 product;
+		Mat2x2 sum;
+	};
+
+	std::size_t window;
+	std::vector<Suffix> front;
+	std::vector<Mat2x2> back;
+	Mat2x2 backProduct;
+	Mat2x2 backSum;
+	void flip();
+public:
+	//0 keeps every matrix until pop()
+	explicit SlidingWindow(std::size_t = 0);
+
+	void push(const Mat2x2&);
+	void pop();
+	void clear();
+
+	std::size_t size() const;
+	bool empty() const;
+	std::size_t capacity() const;
+
+	Mat2x2 product() const;
+	Mat2x2 sum() const;
+};
+#endif
@@ -0,0 +1,133 @@
+#ifndef SPSCQUEUE_H
+#define SPSCQUEUE_H
+#include<atomic>
+#include<cstddef>
+#include<stdexcept>
+#include<thread>
+#include<vector>
+
+//size of a cache line, producer and consumer state live on different lines
+const std::size_t cacheLineSize = 64;
+
+/*
+* a bounded lock-free queue for exactly one producer thread and one
+	consumer thread
+
+* each side keeps a cached copy of the other side's index and only
+	reads the shared atomic when the cached value says the queue looks
+	full (or empty), so in steady state a push or pop touches no cache
+	line owned by the other thread
+*/
+template<typename T>
+class SpscQueue
+{
+private:
+	std::vector<T> slots;
+	std::size_t mask;
+
+	//consumer side
+	alignas(cacheLineSize) std::atomic<std::size_t> head;
+	std::size_t cachedTail;
+
+	//producer side
+	alignas(cacheLineSize) std::atomic<std::size_t> tail;
+	std::size_t cachedHead;
+public:
+	explicit SpscQueue(std::size_t);
+	SpscQueue(const SpscQueue&) = delete;
+	SpscQueue& operator=(const SpscQueue&) = delete;
+
+	bool tryPush(const T&);
+	bool tryPop(T&);
+	std::size_t capacity() const;
+};
+
+/*
+* spins briefly, then yields the core, used by callers that wait on a
+	full or empty queue
+*/
+class Backoff
+{
+private:
+	unsigned spins;
+public:
+	Backoff() : spins{ 0 } {}
+
+	void pause()
+	{
+		if (++this->spins > 64)
+			std::this_thread::yield();
+	}
+
+	void reset()
+	{
+		this->spins = 0;
+	}
+};
+
+/*
+* constructor
+
+* @param  capacity - the number of slots, must be a power of two
+*/
+template<typename T>
+SpscQueue<T>::SpscQueue(std::size_t capacity)
+	: slots(capacity), mask{ capacity - 1 }, head{ 0 }, cachedTail{ 0 }, tail{ 0 }, cachedHead{ 0 }
+{
+	if (capacity == 0 || (capacity & (capacity - 1)) != 0)
+		throw std::invalid_argument("capacity must be a power of two");
+}
+
+/*
+* to add a value at the back, called by the producer only
+
+* @param  value - the value to add
+
+* @return false if the queue is full
+*/
+template<typename T>
+bool SpscQueue<T>::tryPush(const T& value)
+{
+	const std::size_t t = this->tail.load(std::memory_order_relaxed);
+	if (t - this->cachedHead == this->slots.size())
+	{
+		this->cachedHead = this->head.load(std::memory_order_acquire);
+		if (t - this->cachedHead == this->slots.size())
+			return false;
+	}
+	this->slots[t & this->mask] = value;
+	this->tail.store(t + 1, std::memory_order_release);
+	return true;
+}
+
+/*
+* to remove the value at the front, called by the consumer only
+
+* @param  value - receives the removed value
+
+* @return false if the queue is empty
+*/
+template<typename T>
+bool SpscQueue<T>::tryPop(T& value)
+{
+	const std::size_t h = this->head.load(std::memory_order_relaxed);
+	if (h == this->cachedTail)
+	{
+		this->cachedTail = this->tail.load(std::memory_order_acquire);
+		if (h == this->cachedTail)
+			return false;
+	}
+	value = this->slots[h & this->mask];
+	this->head.store(h + 1, std::memory_order_release);
+	return true;
+}
+
+/*
+* @return the number of slots
+*/
+template<typename T>
+std::size_t SpscQueue<T>::capacity() const
+{
+	return this->slots.size();
+}
+#endif
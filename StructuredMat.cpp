@@ -0,0 +1,337 @@
+#include "StructuredMat.h"
+#include "Compensated.h"
+#include<algorithm>
+#include<cfloat>
+#include<cmath>
+#include<stdexcept>
+
+namespace
+{
+	static_assert(sizeof(Mat2x2) == 4 * sizeof(double), "Mat2x2 must be four packed doubles");
+
+	//o = l * r on the packed values a, b, c, d
+	typedef void (*ProductKernel)(const double*, const double*, double*);
+
+	void generalProduct(const double* l, const double* r, double* o)
+	{
+		const double a = l[0] * r[0] + l[1] * r[2];
+		const double b = l[0] * r[1] + l[1] * r[3];
+		const double c = l[2] * r[0] + l[3] * r[2];
+		const double d = l[2] * r[1] + l[3] * r[3];
+		o[0] = a;
+		o[1] = b;
+		o[2] = c;
+		o[3] = d;
+	}
+
+	void diagonalProduct(const double* l, const double* r, double* o)
+	{
+		o[0] = l[0] * r[0];
+		o[1] = 0;
+		o[2] = 0;
+		o[3] = l[3] * r[3];
+	}
+
+	//a diagonal left hand side scales the rows of r
+	void diagonalLeftProduct(const double* l, const double* r, double* o)
+	{
+		const double a = l[0] * r[0], b = l[0] * r[1];
+		const double c = l[3] * r[2], d = l[3] * r[3];
+		o[0] = a;
+		o[1] = b;
+		o[2] = c;
+		o[3] = d;
+	}
+
+	//a diagonal right hand side scales the columns of l
+	void diagonalRightProduct(const double* l, const double* r, double* o)
+	{
+		const double a = l[0] * r[0], b = l[1] * r[3];
+		const double c = l[2] * r[0], d = l[3] * r[3];
+		o[0] = a;
+		o[1] = b;
+		o[2] = c;
+		o[3] = d;
+	}
+
+	/*
+	* the product of two rotations is a rotation, so only its first
+		column is computed, with the same expressions the general
+		kernel uses for it. The other column follows exactly.
+	*/
+	void rotationProduct(const double* l, const double* r, double* o)
+	{
+		const double a = l[0] * r[0] + l[1] * r[2];
+		const double c = l[2] * r[0] + l[3] * r[2];
+		o[0] = a;
+		o[1] = -c;
+		o[2] = c;
+		o[3] = a;
+	}
+
+	void upperProduct(const double* l, const double* r, double* o)
+	{
+		const double a = l[0] * r[0];
+		const double b = l[0] * r[1] + l[1] * r[3];
+		const double d = l[3] * r[3];
+		o[0] = a;
+		o[1] = b;
+		o[2] = 0;
+		o[3] = d;
+	}
+
+	void lowerProduct(const double* l, const double* r, double* o)
+	{
+		const double a = l[0] * r[0];
+		const double c = l[2] * r[0] + l[3] * r[2];
+		const double d = l[3] * r[3];
+		o[0] = a;
+		o[1] = 0;
+		o[2] = c;
+		o[3] = d;
+	}
+
+	/*
+	* the compensated products of operator*= under Arithmetic::Compensated.
+		A sum whose other term is structurally zero is a single rounded
+		product either way, so the diagonal kernels serve both arithmetics.
+	*/
+	void generalCompensatedProduct(const double* l, const double* r, double* o)
+	{
+		const double a = compensatedDot(l[0], r[0], l[1], r[2]);
+		const double b = compensatedDot(l[0], r[1], l[1], r[3]);
+		const double c = compensatedDot(l[2], r[0], l[3], r[2]);
+		const double d = compensatedDot(l[2], r[1], l[3], r[3]);
+		o[0] = a;
+		o[1] = b;
+		o[2] = c;
+		o[3] = d;
+	}
+
+	void upperCompensatedProduct(const double* l, const double* r, double* o)
+	{
+		const double a = l[0] * r[0];
+		const double b = compensatedDot(l[0], r[1], l[1], r[3]);
+		const double d = l[3] * r[3];
+		o[0] = a;
+		o[1] = b;
+		o[2] = 0;
+		o[3] = d;
+	}
+
+	void lowerCompensatedProduct(const double* l, const double* r, double* o)
+	{
+		const double a = l[0] * r[0];
+		const double c = compensatedDot(l[2], r[0], l[3], r[2]);
+		const double d = l[3] * r[3];
+		o[0] = a;
+		o[1] = 0;
+		o[2] = c;
+		o[3] = d;
+	}
+
+	ProductKernel productKernel(MatKind lk, MatKind rk, Arithmetic arithmetic)
+	{
+		if (lk == MatKind::Diagonal && rk == MatKind::Diagonal)
+			return diagonalProduct;
+		if (lk == MatKind::Diagonal)
+			return diagonalLeftProduct;
+		if (rk == MatKind::Diagonal)
+			return diagonalRightProduct;
+		//a compensated sum depends on the order of its terms, so -c is not the compensated b
+		if (arithmetic == Arithmetic::Compensated)
+		{
+			if (lk == MatKind::UpperTriangular && rk == MatKind::UpperTriangular)
+				return upperCompensatedProduct;
+			if (lk == MatKind::LowerTriangular && rk == MatKind::LowerTriangular)
+				return lowerCompensatedProduct;
+			return generalCompensatedProduct;
+		}
+		if (lk == MatKind::Rotation && rk == MatKind::Rotation)
+			return rotationProduct;
+		if (lk == MatKind::UpperTriangular && rk == MatKind::UpperTriangular)
+			return upperProduct;
+		if (lk == MatKind::LowerTriangular && rk == MatKind::LowerTriangular)
+			return lowerProduct;
+		return generalProduct;
+	}
+
+	//the inverse of a rotation is its transpose
+	void rotationInverse(const double* m, double* o)
+	{
+		const double b = m[1], c = m[2];
+		o[0] = m[0];
+		o[1] = c;
+		o[2] = b;
+		o[3] = m[3];
+	}
+
+	/*
+	* the checks and expressions of Mat2x2::inverse(), whose determinant
+		is the single product a * d in either arithmetic when b and c are
+		zero, so the result has the same bits, signed zeros included
+	*/
+	void diagonalInverse(const double* m, double* o)
+	{
+		const double det = m[0] * m[3];
+		if (det == 0)
+			throw std::overflow_error("Divide by zero");
+		if (std::abs(det) <= std::exp(-6))
+			throw std::overflow_error("Inverse undefined");
+		const double a = m[3] * (1 / det);
+		const double b = -m[1] * (1 / det);
+		const double c = -m[2] * (1 / det);
+		const double d = m[0] * (1 / det);
+		o[0] = a;
+		o[1] = b;
+		o[2] = c;
+		o[3] = d;
+	}
+}
+
+/*
+* to find the most specific structure of the matrix
+
+* @param  m - a referrence to a 2x2 matrix
+
+* @return the kind of the matrix
+*/
+MatKind detectKind(const Mat2x2& m)
+{
+	const double a = m[0], b = m[1], c = m[2], d = m[3];
+	if (b == 0 && c == 0)
+		return MatKind::Diagonal;
+	if (a == d && b == -c && std::abs(a * a + b * b - 1) <= 4 * DBL_EPSILON)
+		return MatKind::Rotation;
+	if (b == c)
+		return MatKind::Symmetric;
+	if (c == 0)
+		return MatKind::UpperTriangular;
+	if (b == 0)
+		return MatKind::LowerTriangular;
+	return MatKind::General;
+}
+
+/*
+* to multiply two matrices of known structure
+
+* @param  lhs, lk - the left hand side and its kind
+* @param  rhs, rk - the right hand side and its kind
+* @param  arithmetic - how sums of two products are rounded, like operator*=
+
+* @return a copy of the product
+*/
+Mat2x2 multiply(const Mat2x2& lhs, MatKind lk, const Mat2x2& rhs, MatKind rk, Arithmetic arithmetic)
+{
+	Mat2x2 result;
+	productKernel(lk, rk, arithmetic)(lhs.data(), rhs.data(), result.data());
+	return result;
+}
+
+/*
+* to invert a matrix of known structure, throws like Mat2x2::inverse()
+
+* @param  m - a referrence to a 2x2 matrix
+* @param  kind - the kind of m
+
+* @return a copy of the inverse
+*/
+Mat2x2 invert(const Mat2x2& m, MatKind kind)
+{
+	Mat2x2 result;
+	invert(&m, kind, &result, 1);
+	return result;
+}
+
+/*
+* to find the eigenvalues of a matrix of known structure, triangular
+	and diagonal matrices need no square root at all
+
+* @param  m - a referrence to a 2x2 matrix
+* @param  kind - the kind of m
+
+* @return the eigenvalues, ordered like eigenvalues(m)
+*/
+Eigenvalues eigenvalues(const Mat2x2& m, MatKind kind)
+{
+	const double* v = m.data();
+	Eigenvalues result;
+	switch (kind)
+	{
+	case MatKind::Diagonal:
+	case MatKind::UpperTriangular:
+	case MatKind::LowerTriangular:
+		result.re1 = std::max(v[0], v[3]);
+		result.re2 = std::min(v[0], v[3]);
+		result.im1 = 0;
+		result.im2 = 0;
+		return result;
+	case MatKind::Rotation:
+		//cos(t) +- i |sin(t)|
+		result.re1 = v[0];
+		result.re2 = v[0];
+		result.im1 = std::abs(v[2]);
+		result.im2 = -std::abs(v[2]);
+		return result;
+	case MatKind::Symmetric:
+	{
+		const double mid = (v[0] + v[3]) / 2;
+		const double radius = std::hypot((v[0] - v[3]) / 2, v[1]);
+		result.re1 = mid + radius;
+		result.re2 = mid - radius;
+		result.im1 = 0;
+		result.im2 = 0;
+		return result;
+	}
+	default:
+		return eigenvalues(m);
+	}
+}
+
+/*
+* batched product of matrices of known structure, out[i] = lhs[i] * rhs[i]
+
+* @param  lhs, lk - pointer to the first left hand side and the kind of all of them
+* @param  rhs, rk - pointer to the first right hand side and the kind of all of them
+* @param  out - pointer to the first result, may be lhs or rhs
+* @param  n - the number of products
+* @param  arithmetic - how sums of two products are rounded, like operator*=
+*/
+void multiply(const Mat2x2* lhs, MatKind lk, const Mat2x2* rhs, MatKind rk, Mat2x2* out, std::size_t n, Arithmetic arithmetic)
+{
+	const ProductKernel kernel = productKernel(lk, rk, arithmetic);
+	const double* l = lhs->data();
+	const double* r = rhs->data();
+	double* o = out->data();
+	for (std::size_t i = 0; i < n; i++)
+		kernel(l + 4 * i, r + 4 * i, o + 4 * i);
+}
+
+/*
+* batched inverse of matrices of known structure, throws like
+	Mat2x2::inverse() on the first matrix that has none
+
+* @param  in, kind - pointer to the first matrix and the kind of all of them
+* @param  out - pointer to the first result, may be in
+* @param  n - the number of matrices
+*/
+void invert(const Mat2x2* in, MatKind kind, Mat2x2* out, std::size_t n)
+{
+	const double* m = in->data();
+	double* o = out->data();
+	if (kind == MatKind::Rotation)
+	{
+		for (std::size_t i = 0; i < n; i++)
+			rotationInverse(m + 4 * i, o + 4 * i);
+	}
+	else if (kind == MatKind::Diagonal)
+	{
+		for (std::size_t i = 0; i < n; i++)
+			diagonalInverse(m + 4 * i, o + 4 * i);
+	}
+	else
+	{
+		for (std::size_t i = 0; i < n; i++)
+			out[i] = Mat2x2(in[i]).inverse();
+	}
+}
@@ -0,0 +1,43 @@
+#ifndef STRUCTUREDMAT_H
+#define STRUCTUREDMAT_H
+#include<cstddef>
+#include"Mat2x2.h"
+#include"Decomposition.h"
+
+/*
+* the structure of a matrix, when known it selects a cheaper kernel
+
+* kinds are listed from most to least specific, detectKind() returns
+	the first one that applies
+*/
+enum class MatKind
+{
+	Diagonal,			//b == 0 and c == 0
+	Rotation,			//|cos -sin; sin cos|, a == d, b == -c and a^2 + b^2 == 1 to rounding
+	Symmetric,			//b == c
+	UpperTriangular,	//c == 0
+	LowerTriangular,	//b == 0
+	General
+};
+
+MatKind detectKind(const Mat2x2&);
+
+/*
+* the kernels below trust the kinds they are given. Products of
+	diagonal, triangular and rotation matrices skip only terms that are
+	exactly zero and round like operator*= in the given arithmetic,
+	Mat2x2::arithmetic() by default. Under Compensated they give the same
+	bits as the general path; under Naive too, unless the compiler
+	contracts a * b + c * d into fused multiply-adds differently in the
+	two. Either way a structural zero is always +0. invert() of a
+	diagonal matrix gives the bits of Mat2x2::inverse(), of a rotation
+	its transpose.
+*/
+Mat2x2 multiply(const Mat2x2&, MatKind, const Mat2x2&, MatKind, Arithmetic = Mat2x2::arithmetic());
+Mat2x2 invert(const Mat2x2&, MatKind);
+Eigenvalues eigenvalues(const Mat2x2&, MatKind);
+
+//Batched variants, the kernel is chosen once for the whole batch
+void multiply(const Mat2x2*, MatKind, const Mat2x2*, MatKind, Mat2x2*, std::size_t, Arithmetic = Mat2x2::arithmetic());
+void invert(const Mat2x2*, MatKind, Mat2x2*, std::size_t);
+#endif
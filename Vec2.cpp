@@ -0,0 +1,238 @@
+#include "Vec2.h"
+#include<iostream>
+#include<iomanip>
+#include<stdexcept>
+#include<cstdint>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define VEC2_SSE2
+#include<emmintrin.h>
+#endif
+
+namespace
+{
+	/*
+	* output size (in bytes) above which results are written with
+		non-temporal stores, so a large point cloud does not evict
+		the working set from the cache
+	*/
+	const std::size_t streamingThreshold = std::size_t(4) << 20;
+
+	bool isAligned(const void* p)
+	{
+		return (reinterpret_cast<std::uintptr_t>(p) & 15) == 0;
+	}
+}
+
+/*
+* operator overiding function for the [] operator
+
+* @param  i - the index (0 for x, 1 for y) of the value we are trying to access
+
+* @return a referrence to the double value
+*/
+double& Vec2::operator[](const int i)
+{
+	if (i == 0)
+		return this->x;
+	if (i == 1)
+		return this->y;
+	throw std::invalid_argument("index out of bound");
+}
+
+/*
+* operator overiding function for the [] operator
+
+* @param  i - the index (0 for x, 1 for y) of the value we are trying to access
+
+* @return a const to the double value
+*/
+const double Vec2::operator[](const int i) const
+{
+	if (i == 0)
+		return this->x;
+	if (i == 1)
+		return this->y;
+	throw std::invalid_argument("index out of bound");
+}
+
+/*
+* operator overiding function for the == operator
+
+* @param  lhs, rhs - the two vectors to be compared
+
+* @return a boolean value specifying if the two vectors are equal or not
+*/
+bool operator==(const Vec2& lhs, const Vec2& rhs)
+{
+	return lhs.x == rhs.x && lhs.y == rhs.y;
+}
+
+/*
+* operator overiding function for the != operator
+
+* @param  lhs, rhs - the two vectors to be compared
+
+* @return a boolean value specifying if the two vectors are not equal or equal
+*/
+bool operator!=(const Vec2& lhs, const Vec2& rhs)
+{
+	return !(lhs == rhs);
+}
+
+/*
+* operator overiding function for the output << operator
+	to print the vector as |x y|
+
+* @param  a referrence to ostream
+* @param  a referrence to a vector
+
+* @return a referrence to ostream
+*/
+std::ostream& operator<<(std::ostream& out, const Vec2& v)
+{
+	out << "|" << std::fixed << std::setprecision(2) << v.x << " " << v.y << "|" << std::endl;
+	return out;
+}
+
+/*
+* operator overiding function for the * operator
+	to apply a matrix to a vector
+
+* @param  m - a referrence to the 2x2 matrix
+* @param  v - a referrence to the vector
+
+* @return a copy of the transformed vector
+*/
+Vec2 operator*(const Mat2x2& m, const Vec2& v)
+{
+	const double* e = m.data();
+	return Vec2(e[0] * v.x + e[1] * v.y, e[2] * v.x + e[3] * v.y);
+}
+
+/*
+* transforms an array of points in place
+
+* @param  m - the matrix applied to every point
+* @param  points - pointer to the first point
+* @param  n - the number of points
+*/
+void transform(const Mat2x2& m, Vec2* points, std::size_t n)
+{
+	transform(m, points, points, n);
+}
+
+/*
+* transforms an array of points into a separate output array,
+	out[i] = m * in[i]. in and out may be the same array.
+	The matrix is loaded into registers once and, when the
+	output is large and does not alias the input, results
+	are written with non-temporal stores.
+
+* @param  m - the matrix applied to every point
+* @param  in - pointer to the first input point
+* @param  out - pointer to the first output point
+* @param  n - the number of points
+*/
+void transform(const Mat2x2& m, const Vec2* in, Vec2* out, std::size_t n)
+{
+	const double a = m[0], b = m[1], c = m[2], d = m[3];
+	std::size_t i = 0;
+#ifdef VEC2_SSE2
+	const double* src = reinterpret_cast<const double*>(in);
+	double* dst = reinterpret_cast<double*>(out);
+	const __m128d col0 = _mm_set_pd(c, a);
+	const __m128d col1 = _mm_set_pd(d, b);
+	if (in != out && n * sizeof(Vec2) >= streamingThreshold)
+	{
+		for (; i + 1 < n; i += 2)
+		{
+			__m128d p0 = _mm_load_pd(src + 2 * i);
+			__m128d p1 = _mm_load_pd(src + 2 * i + 2);
+			__m128d r0 = _mm_add_pd(_mm_mul_pd(col0, _mm_unpacklo_pd(p0, p0)), _mm_mul_pd(col1, _mm_unpackhi_pd(p0, p0)));
+			__m128d r1 = _mm_add_pd(_mm_mul_pd(col0, _mm_unpacklo_pd(p1, p1)), _mm_mul_pd(col1, _mm_unpackhi_pd(p1, p1)));
+			_mm_stream_pd(dst + 2 * i, r0);
+			_mm_stream_pd(dst + 2 * i + 2, r1);
+		}
+		_mm_sfence();
+	}
+	else
+	{
+		for (; i + 1 < n; i += 2)
+		{
+			__m128d p0 = _mm_load_pd(src + 2 * i);
+			__m128d p1 = _mm_load_pd(src + 2 * i + 2);
+			__m128d r0 = _mm_add_pd(_mm_mul_pd(col0, _mm_unpacklo_pd(p0, p0)), _mm_mul_pd(col1, _mm_unpackhi_pd(p0, p0)));
+			__m128d r1 = _mm_add_pd(_mm_mul_pd(col0, _mm_unpacklo_pd(p1, p1)), _mm_mul_pd(col1, _mm_unpackhi_pd(p1, p1)));
+			_mm_store_pd(dst + 2 * i, r0);
+			_mm_store_pd(dst + 2 * i + 2, r1);
+		}
+	}
+#endif
+	for (; i < n; i++)
+	{
+		double x = in[i][0], y = in[i][1];
+		out[i] = Vec2(a * x + b * y, c * x + d * y);
+	}
+}
+
+/*
+* transforms a point cloud stored as separate x and y arrays in place
+
+* @param  m - the matrix applied to every point
+* @param  xs, ys - pointers to the x and y coordinates
+* @param  n - the number of points
+*/
+void transform(const Mat2x2& m, double* xs, double* ys, std::size_t n)
+{
+	transform(m, xs, ys, xs, ys, n);
+}
+
+/*
+* transforms a point cloud stored as separate x and y arrays,
+	(outX[i], outY[i]) = m * (xs[i], ys[i]). The output arrays
+	may be the same as the input arrays. Large non-aliasing outputs
+	that are 16-byte aligned are written with non-temporal stores.
+
+* @param  m - the matrix applied to every point
+* @param  xs, ys - pointers to the input x and y coordinates
+* @param  outX, outY - pointers to the output x and y coordinates
+* @param  n - the number of points
+*/
+void transform(const Mat2x2& m, const double* xs, const double* ys, double* outX, double* outY, std::size_t n)
+{
+	const double a = m[0], b = m[1], c = m[2], d = m[3];
+	std::size_t i = 0;
+#ifdef VEC2_SSE2
+	const __m128d va = _mm_set1_pd(a), vb = _mm_set1_pd(b);
+	const __m128d vc = _mm_set1_pd(c), vd = _mm_set1_pd(d);
+	if (xs != outX && ys != outY && isAligned(outX) && isAligned(outY)
+		&& 2 * n * sizeof(double) >= streamingThreshold)
+	{
+		for (; i + 1 < n; i += 2)
+		{
+			__m128d x = _mm_loadu_pd(xs + i);
+			__m128d y = _mm_loadu_pd(ys + i);
+			_mm_stream_pd(outX + i, _mm_add_pd(_mm_mul_pd(va, x), _mm_mul_pd(vb, y)));
+			_mm_stream_pd(outY + i, _mm_add_pd(_mm_mul_pd(vc, x), _mm_mul_pd(vd, y)));
+		}
+		_mm_sfence();
+	}
+	else
+	{
+		for (; i + 1 < n; i += 2)
+		{
+			__m128d x = _mm_loadu_pd(xs + i);
+			__m128d y = _mm_loadu_pd(ys + i);
+			_mm_storeu_pd(outX + i, _mm_add_pd(_mm_mul_pd(va, x), _mm_mul_pd(vb, y)));
+			_mm_storeu_pd(outY + i, _mm_add_pd(_mm_mul_pd(vc, x), _mm_mul_pd(vd, y)));
+		}
+	}
+#endif
+	for (; i < n; i++)
+	{
+		double x = xs[i], y = ys[i];
+		outX[i] = a * x + b * y;
+		outY[i] = c * x + d * y;
+	}
+}
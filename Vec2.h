@@ -0,0 +1,43 @@
+#ifndef VEC2_H
+#define VEC2_H
+#include<iostream>
+#include<cstddef>
+#include"Mat2x2.h"
+
+/*
+* a 2-D column vector |x y|^T
+
+* aligned to 16 bytes so that a point fills exactly one SSE2 register
+	and arrays of points can be streamed with aligned loads and stores
+*/
+class alignas(16) Vec2
+{
+private:
+	double x, y;
+public:
+	Vec2();
+	Vec2(double, double);
+
+	friend std::ostream& operator<<(std::ostream&, const Vec2&);
+
+	//Relational
+	friend bool operator==(const Vec2&, const Vec2&);
+	friend bool operator!=(const Vec2&, const Vec2&);
+
+	//Subscript
+	double& operator[](const int);
+	const double operator[](const int) const;
+
+	friend Vec2 operator*(const Mat2x2&, const Vec2&);
+};
+inline Vec2::Vec2() : x{ 0 }, y{ 0 } {}
+inline Vec2::Vec2(double x, double y) : x{ x }, y{ y } {}
+
+//Bulk point-cloud transforms, array of structures
+void transform(const Mat2x2&, Vec2*, std::size_t);
+void transform(const Mat2x2&, const Vec2*, Vec2*, std::size_t);
+
+//Bulk point-cloud transforms, structure of arrays
+void transform(const Mat2x2&, double*, double*, std::size_t);
+void transform(const Mat2x2&, const double*, const double*, double*, double*, std::size_t);
+#endif
@@ -2,11 +2,42 @@
 #include<iomanip>
 #include<string>
 #include<cassert>
+#include<algorithm>
+#include<sstream>
+#include<limits>
+#include<fstream>
+#include<cstring>
+#include<cmath>
+#include<future>
 #include"Mat2x2.h"
+#include"Vec2.h"
+#include"Decomposition.h"
+#include"Conditioning.h"
+#include"MatArena.h"
+#include"PropertyCheck.h"
+#include"Pipeline.h"
+#include"MatQueue.h"
+#include<thread>
+#include<cstdio>
+#include"AsyncBatchIO.h"
+#include"StructuredMat.h"
+#include"CpuDispatch.h"
+#include"Interval.h"
+#include"CompressedMatrices.h"
+#include"ShardedBatch.h"
+#include"SlidingWindow.h"
+#include"Bench.h"
 using namespace std;
 
-int main()
+int main(int argc, char* argv[])
 {
+	//driver --bench [name] times the batch kernels instead of testing
+	if (argc > 1 && string(argv[1]) == "--bench")
+	{
+		runBenchmarks(cout, argc > 2 ? argv[2] : "");
+		return 0;
+	}
+
 	Mat2x2 m1(2, -1, 1, 2);
 	cout << "m1\n" << m1 << endl;
 
@@ -89,6 +120,7 @@ int main()
 	m9[3] = 4;
 	cout << "m9\n" << m9 << endl;
 	assert(m9 == Mat2x2(3, 1, 7, 4));
+	assert(m9.data()[2] == 7 && &m9.data()[3] == &m9[3]);
 	cout << "det(m1) =  " << m1() << "\ntrace(m1) = " << m1.trace() << "\n\n";
 	cout << "det(m9) =  " << m9() << "\ntrace(m1) = " << m9.trace() << "\n\n";
 	cout << "m9 is " << (m9.isSimilar(m1) ? "" : "not ") << "similar to m1\n";
@@ -126,10 +158,8 @@ int main()
 	assert(m10 == m11.transpose());
 
 	Mat2x2 m12;
-	cout << "In response to the following prompt\n";
-	cout << "enter the numbers 10, 20, 30, 40 in that order\n\n";
-
-	cin >> m12;
+	istringstream m12Input("10 20 30 40");
+	m12Input >> m12;
 	cout << "m12\n" << m12 << endl;
 	assert(m12 == Mat2x2(10, 20, 30, 40));
 
@@ -137,7 +167,342 @@ int main()
 	cout << "m13\n" << m13 << endl;
 	assert(+m11 == -m13);
 
+	Vec2 v1(1, 2);
+	Vec2 v2 = m1 * v1;
+	cout << "m1 * v1\n" << v2 << endl;
+	assert(v2 == Vec2(0, 5));
+
+	std::vector<Vec2> points{ Vec2(1, 0), Vec2(0, 1), Vec2(1, 2) };
+	transform(m1, points.data(), points.size());
+	assert(points[0] == Vec2(2, 1) && points[1] == Vec2(-1, 2) && points[2] == Vec2(0, 5));
+
+	std::vector<double> xs{ 1, 0, 1 }, ys{ 0, 1, 2 };
+	transform(m1, xs.data(), ys.data(), xs.size());
+	assert(xs[2] == 0 && ys[2] == 5);
+
+	SingularValueDecomposition s1 = svd(m1);
+	assert(std::abs(s1.sigma1 - std::sqrt(5.0)) < 1.e-12 && std::abs(s1.sigma2 - std::sqrt(5.0)) < 1.e-12);
+
+	EigenDecomposition e9 = symmetricEigen(Mat2x2(2, 1, 1, 2));
+	assert(std::abs(e9.lambda1 - 3) < 1.e-12 && std::abs(e9.lambda2 - 1) < 1.e-12);
+
+	QRDecomposition qr9 = qr(m9);
+	assert(qr9.r[2] == 0);
+
+	assert(norm1(Mat2x2(3, 1, 7, 4)) == 10 && normInf(Mat2x2(3, 1, 7, 4)) == 11);
+	assert(std::abs(norm2(m1) - std::sqrt(5.0)) < 1.e-12);
+	assert(std::abs(conditionNumber(m1) - 1) < 1.e-12);
+	assert(std::abs(conditionNumber(Mat2x2(1.e-3, 0, 0, 1.e-3)) - 1) < 1.e-12);
+	assert(conditionNumber(Mat2x2(1.e-310, 0, 0, 1.e-310)) == 1);
+	assert(std::abs(conditionNumber(Mat2x2(1.e-310, 0, 0, 3.e-310)) - 3) < 1.e-9);
+	assert(conditionNumber(Mat2x2(1.e308, 0, 0, 1.e308)) == 1);
+	assert(std::abs(conditionNumber(Mat2x2(1.e308, -1.e308, 1.e308, 1.e308)) - 1) < 1.e-12);
+	assert(std::abs(conditionNumber(Mat2x2(1.e308, 0, 0, 1.e300)) - 1.e8) < 1);
+	const double huge = std::ldexp(3.0, 1020);
+	assert(conditionNumber(Mat2x2(huge, huge, huge, huge)) == std::numeric_limits<double>::infinity());
+
+	std::vector<Mat2x2> batch{ m1, Mat2x2(1, 2, 2, 4), Mat2x2(1, 1, 1, 1 + 1.e-10) };
+	ConditionPartition partition = partitionByConditioning(batch.data(), batch.size());
+	assert(partition.wellConditioned.size() == 1 && partition.wellConditioned[0] == 0);
+	assert(partition.singular.size() == 1 && partition.singular[0] == 1);
+	assert(partition.illConditioned.size() == 1 && partition.illConditioned[0] == 2);
+
+	std::vector<ConditionClass> extremeClasses(9);
+	std::vector<Mat2x2> extremes{ Mat2x2(1.e-310, 0, 0, 1.e-310), Mat2x2(1.e308, 0, 0, -1.e308), Mat2x2(4.e-320, 0, 0, 4.e-320),
+		Mat2x2(1.e-310, 1.e-310, 1.e-310, 1.e-310), Mat2x2(1.e308, 1.e308, 1.e308, 1.e308), Mat2x2(1.e200, 0, 0, 1.e191),
+		Mat2x2(1.e-300, 0, 0, 1.e-309), Mat2x2(), Mat2x2(1.e-310, 0, 0, 2.e-310) };
+	classifyConditioning(extremes.data(), extremeClasses.data(), extremes.size());
+	for (int i : { 0, 1, 2, 8 })
+		assert(extremeClasses[i] == ConditionClass::WellConditioned);
+	for (int i : { 5, 6 })
+		assert(extremeClasses[i] == ConditionClass::IllConditioned);
+	for (int i : { 3, 4, 7 })
+		assert(extremeClasses[i] == ConditionClass::Singular);
+
+	CountingResource heap;
+	MatArena arena(64 * 1024, &heap);
+	for (int request = 0; request < 3; request++)
+	{
+		Mat2x2Batch scratch = arena.batch(batch.size());
+		scratch.assign(batch.begin(), batch.end());
+		EigenvaluesBatch roots = eigenvalues(scratch.data(), scratch.size(), arena.resource());
+		ConditionPartition scratchPartition = partitionByConditioning(scratch.data(), scratch.size(), defaultMaxCondition, arena.resource());
+		assert(roots[0].re1 == 2 && roots[0].im1 == 1 && roots[0].im2 == -1);
+		assert(scratchPartition.wellConditioned.size() == 1);
+		arena.release();
+	}
+	assert(heap.allocations() == 0);
+
+	const Distribution distributions[] = { Distribution::Uniform, Distribution::Symmetric,
+		Distribution::Singular, Distribution::NearSingular, Distribution::ComplexEigenvalues,
+		Distribution::HugeDynamicRange };
+	for (Distribution distribution : distributions)
+	{
+		PropertyReport report = checkProperties(distribution, 100000, 2019);
+		assert(report.passed());
+		assert(report.transpose.checked == 100000);
+		if (distribution == Distribution::Singular || distribution == Distribution::NearSingular)
+			assert(report.inverse.checked == 100000 && report.inverse.skipped == 0);
+	}
+	assert(!checkProperties(Distribution::Uniform, 0, 2019).passed());
+	assert(generate(Distribution::Uniform, 10000, 7, 1) == generate(Distribution::Uniform, 10000, 7, 4));
+
+	std::vector<Mat2x2> input = generate(Distribution::Symmetric, 100000, 11);
+	std::size_t consumed = 0, symmetric = 0;
+	Pipeline pipeline(1024, 2);
+	pipeline.map([](Mat2x2& m) { m *= 2; })
+		.filter([](const Mat2x2& m) { return m.isSymmetric() && m[0] > 0; });
+	pipeline.run([&](Mat2x2* out, std::size_t max)
+	{
+		std::size_t n = std::min(max, input.size() - consumed);
+		std::copy(input.begin() + consumed, input.begin() + consumed + n, out);
+		consumed += n;
+		return n;
+	}, [&](const Mat2x2*, std::size_t n) { symmetric += n; });
+	assert(consumed == input.size());
+	assert(symmetric == std::size_t(std::count_if(input.begin(), input.end(), [](const Mat2x2& m) { return m[0] > 0; })));
+	bool overfillReported = false;
+	try
+	{
+		pipeline.run([](Mat2x2*, std::size_t max) { return max + 1; }, [](const Mat2x2*, std::size_t) {});
+	}
+	catch (const std::logic_error&)
+	{
+		overfillReported = true;
+	}
+	assert(overfillReported);
+
+	MatMpmcQueue work(256);
+	std::vector<double> traces(4, 0);
+	std::vector<std::thread> workers;
+	for (std::size_t t = 0; t < traces.size(); t++)
+	{
+		workers.emplace_back([&work, &traces, t]()
+		{
+			Mat2x2 m;
+			for (pop(work, m); m[3] >= 0; pop(work, m))
+				traces[t] += m.trace();
+		});
+	}
+	for (std::size_t i = 0; i < input.size(); i++)
+		push(work, Mat2x2(1, 0, 0, 1));
+	for (std::size_t t = 0; t < traces.size(); t++)
+		push(work, Mat2x2(0, 0, 0, -1));
+	for (std::thread& worker : workers)
+		worker.join();
+	assert(traces[0] + traces[1] + traces[2] + traces[3] == 2.0 * input.size());
+
+	writeMatrixFile("driver_in.bin", input.data(), input.size());
+	FileBatchOptions fileOptions;
+	fileOptions.chunkSize = 4096;
+	assert(processFile("driver_in.bin", "driver_out.bin", BatchOperation::Multiply, m1, fileOptions) == input.size());
+	std::vector<Mat2x2> output = readMatrixFile("driver_out.bin");
+	assert(output.size() == input.size() && output[12345] == input[12345] * m1);
+	std::future<std::size_t> inverted = processFileAsync("driver_in.bin", "driver_out.bin", BatchOperation::Inverse, m1, fileOptions);
+	assert(inverted.get() == input.size());
+	std::vector<Mat2x2> asyncInverses = readMatrixFile("driver_out.bin");
+	fileOptions.ioUring = false;
+	assert(processFile("driver_in.bin", "driver_out.bin", BatchOperation::Inverse, m1, fileOptions) == input.size());
+	std::vector<Mat2x2> threadedInverses = readMatrixFile("driver_out.bin");
+	assert(threadedInverses.size() == asyncInverses.size()
+		&& std::memcmp(threadedInverses.data(), asyncInverses.data(), asyncInverses.size() * sizeof(Mat2x2)) == 0);
+	{
+		std::ofstream truncated("driver_in.bin", std::ios::binary | std::ios::app);
+		truncated.write("partial", 7);
+	}
+	for (bool ioUring : { false, true })
+	{
+		fileOptions.ioUring = ioUring;
+		bool truncationReported = false;
+		try
+		{
+			processFileAsync("driver_in.bin", "driver_out.bin", BatchOperation::Multiply, m1, fileOptions).get();
+		}
+		catch (const std::runtime_error&)
+		{
+			truncationReported = true;
+		}
+		assert(truncationReported);
+	}
+	std::remove("driver_in.bin");
+	std::remove("driver_out.bin");
+
+	Mat2x2 rotation(0.6, -0.8, 0.8, 0.6);
+	Mat2x2 scaling(2, 0, 0, 0.5);
+	assert(detectKind(rotation) == MatKind::Rotation && detectKind(scaling) == MatKind::Diagonal);
+	assert(detectKind(m9) == MatKind::General && detectKind(Mat2x2(2, 1, 1, 2)) == MatKind::Symmetric);
+	Mat2x2 quarterTurn(0, -1, 1, 0);
+	assert(multiply(quarterTurn, MatKind::Rotation, quarterTurn, MatKind::Rotation) == quarterTurn * quarterTurn);
+	assert(multiply(scaling, MatKind::Diagonal, m9, MatKind::General) == scaling * m9);
+	assert(invert(rotation, MatKind::Rotation) == rotation.transpose());
+	Eigenvalues rotationRoots = eigenvalues(rotation, MatKind::Rotation);
+	assert(rotationRoots.re1 == 0.6 && rotationRoots.im1 == 0.8 && rotationRoots.im2 == -0.8);
+	std::vector<Mat2x2> structured = generate(Distribution::Uniform, 10000, 34);
+	for (Arithmetic arithmetic : { Arithmetic::Naive, Arithmetic::Compensated })
+	{
+		Mat2x2::setArithmetic(arithmetic);
+		for (std::size_t i = 0; i + 1 < structured.size(); i++)
+		{
+			Mat2x2 upper(structured[i][0], structured[i][1], 0, structured[i][3]);
+			Mat2x2 nextUpper(structured[i + 1][0], structured[i + 1][1], 0, structured[i + 1][3]);
+			assert(multiply(upper, MatKind::UpperTriangular, nextUpper, MatKind::UpperTriangular) == upper * nextUpper);
+
+			//the same bits as inverse(), or the same exception
+			Mat2x2 diagonal(4 * structured[i][0], 0, 0, 4 * structured[i][3]);
+			Mat2x2 expected, actual;
+			bool expectedThrow = false, actualThrow = false;
+			try
+			{
+				expected = diagonal.inverse();
+			}
+			catch (const std::overflow_error&)
+			{
+				expectedThrow = true;
+			}
+			try
+			{
+				actual = invert(diagonal, MatKind::Diagonal);
+			}
+			catch (const std::overflow_error&)
+			{
+				actualThrow = true;
+			}
+			assert(expectedThrow == actualThrow && std::memcmp(expected.data(), actual.data(), sizeof(Mat2x2)) == 0);
+		}
+	}
+	Mat2x2::setArithmetic(Arithmetic::Naive);
+
+	assert(activeIsa() <= detectIsa() && kernels().level == activeIsa());
+	assert(selfTest(10000));
+	std::vector<Mat2x2> batchIn = { Mat2x2(1, 2, 3, 4), quarterTurn, scaling, Mat2x2(1, 2, 2, 4), m9 };
+	std::vector<Mat2x2> batchOut(batchIn.size());
+	kernels().multiply(batchIn.data(), batchIn.data(), batchOut.data(), batchIn.size());
+	assert(batchOut[0] == Mat2x2(7, 10, 15, 22) && batchOut[1] == quarterTurn * quarterTurn);
+	assert(kernels().inverse(batchIn.data(), batchOut.data(), batchIn.size()) == 1);
+	assert(batchOut[2] == Mat2x2(0.5, 0, 0, 2));
+
+	//ad and bc round to the same double, so without FMA contraction the naive determinant is 0
+	Mat2x2 cancelling(1e8 + 1, 1e8, 1e8, 1e8 - 1);
+	Interval cancellingDet = certifiedDeterminant(cancelling);
+	assert(cancellingDet.lower() == -1 && cancellingDet.upper() == -1);
+	IntervalMat2x2 certified(cancelling);
+	assert(certified.inverse().contains(Mat2x2(-99999999, 1e8, 1e8, -100000001)));
+	IntervalEigenvalues certifiedRoots = eigenvalues(IntervalMat2x2(Mat2x2(2, 1, 1, 2)));
+	assert(certifiedRoots.re1.contains(3) && certifiedRoots.re2.contains(1) && certifiedRoots.im1.width() == 0);
+	Interval third = Interval(1) / Interval(3);
+	assert(third.lower() < third.upper() && third.contains(1.0 / 3));
+
+	assert(cancelling.determinant(Arithmetic::Compensated) == -1);
+	Mat2x2::setArithmetic(Arithmetic::Compensated);
+	assert(cancelling.inverse() == Mat2x2(-99999999, 1e8, 1e8, -100000001));
+	assert(kernels().arithmetic == Arithmetic::Compensated);
+	double compensatedDet, compensatedTrace;
+	kernels().determinantTrace(&cancelling, &compensatedDet, &compensatedTrace, 1);
+	assert(compensatedDet == -1 && compensatedTrace == 2e8);
+	Mat2x2::setArithmetic(Arithmetic::Naive);
+	//the arithmetic passed per call wins over the policy
+	assert(cancelling.inverse(Arithmetic::Compensated) == Mat2x2(-99999999, 1e8, 1e8, -100000001));
+	Mat2x2 cancellingProduct(1e8 + 1, 1e8, 0, 1);
+	Mat2x2 cancellingFactor(1e8 - 1, 0, -1e8, 1);
+	cancellingProduct.multiplyBy(cancellingFactor, Arithmetic::Compensated);
+	assert(cancellingProduct == Mat2x2(-1, 1e8, -1e8, 1));
+	//det = 1 exactly, a double eigenvalue 1; the naive determinant may round to 0 and split it
+	std::vector<Mat2x2> doubleRoot(9, Mat2x2(1e8 + 1, 1e8, -1e8, -(1e8 - 1)));
+	std::vector<Eigenvalues> doubleRoots(doubleRoot.size());
+	for (int level = static_cast<int>(IsaLevel::Scalar); level <= static_cast<int>(detectIsa()); level++)
+	{
+		kernels(static_cast<IsaLevel>(level), Arithmetic::Compensated).eigenvalues(doubleRoot.data(), doubleRoots.data(), doubleRoot.size());
+		for (const Eigenvalues& roots : doubleRoots)
+			assert(roots.re1 == 1 && roots.re2 == 1 && roots.im1 == 0 && roots.im2 == 0);
+	}
+
+	assert(storedKind(Mat2x2(1, 0, 0, 1)) == StoredKind::Identity && storedKind(scaling) == StoredKind::Diagonal);
+	assert(storedKind(rotation) == StoredKind::Rotation && storedKind(Mat2x2(-0.0, 0, 0, 1)) == StoredKind::Diagonal);
+	assert(storedKind(Mat2x2(1, -0.0, 0, 2)) == StoredKind::UpperTriangular);
+	CompressedMatrices archive(true, 64);
+	for (std::size_t i = 0; i < 1000; i++)
+		archive.push_back(i % 3 == 0 ? input[i] : i % 3 == 1 ? Mat2x2(1, 0, 0, 1) : scaling);
+	assert(archive.size() == 1000 && archive.compressedBytes() * 2 < 1000 * sizeof(Mat2x2));
+	assert(archive[999] == input[999] && archive[499] == Mat2x2(1, 0, 0, 1) && archive[65] == scaling);
+	double archiveTrace = 0;
+	archive.scan([&](const Mat2x2* m, std::size_t n)
+	{
+		std::vector<double> dets(n), traces(n);
+		kernels().determinantTrace(m, dets.data(), traces.data(), n);
+		for (double trace : traces)
+			archiveTrace += trace;
+	});
+	double expectedTrace = 0;
+	for (std::size_t i = 0; i < 1000; i++)
+		expectedTrace += archive[i].trace();
+	assert(archiveTrace == expectedTrace);
+	//every kind and block format round trips bit for bit, and random matrices take at most a header byte a block over raw
+	const std::vector<Mat2x2> general = generate(Distribution::Uniform, 100, 38);
+	const Mat2x2 ofEveryKind[] = { Mat2x2(1, 0, 0, 1), scaling, rotation, Mat2x2(1, 2, 2, -0.0), Mat2x2(1, -0.0, 0, 2), Mat2x2(1, 0, 3, 2) };
+	auto archived = [&](std::size_t i) { return i < 14 ? rotation : i % 13 < 6 ? ofEveryKind[i % 13] : general[i]; };
+	for (bool xorFields : { false, true })
+	{
+		CompressedMatrices kinds(xorFields, 7), random(xorFields, 7);
+		for (std::size_t i = 0; i < general.size(); i++)
+		{
+			kinds.push_back(archived(i));
+			random.push_back(general[i]);
+		}
+		std::vector<Mat2x2> decoded(general.size());
+		kinds.decode(0, decoded.data(), decoded.size());
+		for (std::size_t i = 0; i < decoded.size(); i++)
+		{
+			const Mat2x2 expected = archived(i);
+			assert(std::memcmp(&decoded[i], &expected, sizeof(Mat2x2)) == 0 && kinds[i] == expected);
+		}
+		assert(random.compressedBytes() <= general.size() * sizeof(Mat2x2) + 14 * (1 + sizeof(std::size_t)));
+	}
+
+	std::vector<Mat2x2> shears(1000), shearInverses(shears.size()), expectedInverses(shears.size());
+	Mat2x2 shearSum, shearProduct(1, 0, 0, 1);
+	for (std::size_t i = 0; i < shears.size(); i++)
+	{
+		shears[i] = Mat2x2(1, double(i % 7), 0, 1);
+		shearSum += shears[i];
+		shearProduct *= shears[i];
+	}
+	ShardOptions shardOptions;
+	shardOptions.shardSize = 100;
+	assert(runSharded(ShardOperation::Sum, shears.data(), nullptr, shears.size(), shardOptions).reduction == shearSum);
+	assert(runSharded(ShardOperation::Product, shears.data(), nullptr, shears.size(), shardOptions).reduction == shearProduct);
+	kernels().inverse(shears.data(), expectedInverses.data(), shears.size());
+	ShardServer shardServer;
+	shardServer.dropConnectionsAfter(2);
+	std::thread serving(&ShardServer::serve, &shardServer);
+	const std::string endpoint = "127.0.0.1:" + std::to_string(shardServer.port());
+	shardOptions.endpoints = { endpoint, endpoint };
+	shardOptions.retries = 10;
+	ShardedResult remote = runSharded(ShardOperation::Inverse, shears.data(), shearInverses.data(), shears.size(), shardOptions);
+	assert(remote.restarts > 0 && shearInverses[999] == expectedInverses[999] && shearInverses[0] == Mat2x2(1, 0, 0, 1));
+	assert(std::equal(shearInverses.begin(), shearInverses.end(), expectedInverses.begin()));
+	shardServer.stop();
+	serving.join();
+	ShardServer stoppedEarly;
+	stoppedEarly.stop();
+	stoppedEarly.serve();
+
+	SlidingWindow recent(3);
+	Mat2x2 singular(1, 1, 1, 1);
+	recent.push(quarterTurn);
+	recent.push(singular);
+	recent.push(scaling);
+	Mat2x2 windowProduct = quarterTurn * singular;
+	assert(recent.product() == (windowProduct *= scaling) && recent.size() == 3);
+	recent.push(shears[1]);
+	windowProduct = singular * scaling;
+	Mat2x2 windowSum = singular + scaling;
+	assert(recent.product() == (windowProduct *= shears[1]) && recent.sum() == (windowSum += shears[1]));
+	recent.pop();
+	assert(recent.product() == scaling * shears[1] && recent.size() == 2);
+	recent.pop();
+	recent.pop();
+	assert(recent.empty() && recent.product() == Mat2x2(1, 0, 0, 1) && recent.sum() == Mat2x2());
+
 	cout << "Test completed successfully!" << endl;
-	//return 0;
-	system("pause");
+	return 0;
 }